@@ -57,12 +57,44 @@ extern "C"
 	typedef void (*voidFuncPtr)(void);
 
 /* Redefinitions ******************************/
+#if defined(USE_TICKLESS)
+#define delay system_delay
+#define delay_ms system_delay
+#else
 #define delay LL_mDelay
 #define delay_ms LL_mDelay
+#endif
 #define system_softReset NVIC_SystemReset
 
 	/* Millis *************************************/
 	uint32_t millis(void);
+#if !defined(USE_TICKLESS)
+	uint32_t micros(void); // millis() and the SysTick counter, wraps every 71 minutes
+#endif
+	// Used by the clock and low power functions to stop/restart the millis() interrupt
+	void system_tickResume(void);
+	void system_tickSuspend(void);
+
+/* Tickless Mode ******************************/
+// Compile with USE_TICKLESS (STM32G071/G081 only) to replace the 1 ms SysTick
+// interrupt by LPTIM1 (or LPTIM2 with USE_TICKLESS_LPTIM2) clocked from LSE
+// (or LSI with TICKLESS_USE_LSI). The core is only woken up for the next
+// deadline, or every 32 seconds to keep the timebase, and millis() keeps
+// counting in Stop 0/1 modes. The timebase starts with the clock functions or
+// the first millis()/system_delay() call. The low power functions go back to
+// sleep when the LPTIM is the only wakeup source.
+#if defined(USE_TICKLESS)
+// Definitions
+#define TICKLESS_DEADLINE_DELAY 0
+#define TICKLESS_DEADLINE_STIMER 1
+#define TICKLESS_DEADLINE_IDLE 2
+#define TICKLESS_DEADLINES 3
+	// Functions
+	void system_delay(uint32_t milliseconds); // sleeps until the deadline
+	void tickless_setDeadline(uint8_t TICKLESS_DEADLINE_x, uint32_t millis_time);
+	void tickless_clearDeadline(uint8_t TICKLESS_DEADLINE_x);
+	bool tickless_serviceWakeup(void); // after a WFI with interrupts disabled: runs the LPTIM interrupt, true if nothing else is pending
+#endif
 
 	/* Clock Functions ***************************/
 	void CLOCK_HSI_64MHZ(void);
@@ -72,6 +104,21 @@ extern "C"
 	void CLOCK_HSI_4MHZ(void);
 	void CLOCK_HSI_2MHZ(void);
 	void clock_init(void (*clockFunc)(void)); // Function defined in "system_lowpower_l0.c"
+	// Wakeup from Stop modes: the running clock is saved before entering, the
+	// core wakes up on HSI16, HSE is restarted (if it was on) and the PLL
+	// configuration is restored. With CLOCK_WAKEUP_ASYNC the code keeps running
+	// on HSI16 (PCLK peripherals run slower) and the RCC interrupt switches to
+	// the PLL once it's locked.
+	// Compile with CLOCK_WAKEUP_PIN (like -DCLOCK_WAKEUP_PIN=PA5) to set the
+	// pin from the first instruction after the wakeup until the clock is
+	// restored: the wakeup latency is the delay from the wakeup event to its
+	// rising edge. The pin is set up by clock_init().
+#define CLOCK_WAKEUP_WAIT 0	// wait for the PLL (default)
+#define CLOCK_WAKEUP_ASYNC 1 // switch to the PLL in the RCC interrupt
+	void clock_setWakeup(uint8_t CLOCK_WAKEUP_x);
+	void clock_restore(void);						// waits for the PLL after an asynchronous wakeup
+	bool clock_isRestored(void);
+	uint16_t clock_getWakeupMicros(void); // last wakeup, from the first instruction to the restored clock
 
 /* System RTC Functions **********************/
 //Definitions
@@ -130,6 +177,14 @@ extern "C"
 	void rtc_getTime(RTCTime_t *rtc_time);
 	void rtc_getDate(RTCDate_t *rtc_date);
 	uint32_t rtc_getUnix(void);
+	uint64_t rtc_getUnixMs(void); // milliseconds, using the subseconds register
+	// Calibration: the RTC clock (LSI or LSE) is measured with TIM16 against the
+	// system clock, use HSE as system clock for an accurate (crystal) reference.
+	// rtc_calibrate() sets the prescalers and the smooth calibration (CALR).
+	// TIM16 is borrowed for the measurement, it fails while TIM16 is running
+	// (PWM, USE_STIMER_TIM16...), a stopped TIM16 keeps its configuration.
+	uint32_t rtc_measureClock(uint16_t periods); // mHz, periods of 8 RTC cycles, 0 if it isn't running or TIM16 is busy
+	bool rtc_calibrate(uint32_t clock_mhz);			 // false if it's out of range
 	// RTC Interrupts
 	void rtc_setWKUPMillis(uint16_t milliseconds); //put 0 to disable
 	void rtc_setWKUPSeconds(uint16_t seconds);		 //put 0 to disable
@@ -216,7 +271,82 @@ extern "C"
 	void system_shutdownUntilWakeUpPin(uint32_t WAKEUP_PIN_x, uint8_t polarity); // This function doesn't required rtc
 #endif
 
+/* Power Manager Functions **********************/
+// The drivers require the deepest low power mode they keep working in while
+// they are active (a USART receiving on PCLK needs Sleep mode), and
+// system_idle() enters the deepest mode allowed by all of them. Stop modes
+// need USE_TICKLESS or the RTC to wake up at the deadline. Without
+// USE_TICKLESS system_idle() owns the RTC wakeup timer, rtc_setWKUP...()
+// can't be used with it.
+// Definitions
+#define POWER_MODE_RUN 0
+#define POWER_MODE_SLEEP 1
+#define POWER_MODE_STOP0 2
+#define POWER_MODE_STOP1 3 // deepest, no requirement
+#define POWER_USER_UART1 (1UL << 0)
+#define POWER_USER_UART2 (1UL << 1)
+#define POWER_USER_SPI1 (1UL << 2) // SPI slave
+#define POWER_USER_SPI2 (1UL << 3)
+#define POWER_USER_PWMDMA (1UL << 4)
+#define POWER_USER_STIMER (1UL << 5) // hardware timer of stimer, while timers are running
+#define POWER_USER_TIM1 (1UL << 6)	 // tim_interrupt() and pwm, until tim_off()
+#define POWER_USER_TIM2 (1UL << 7)
+#define POWER_USER_TIM3 (1UL << 8)
+#define POWER_USER_TIM6 (1UL << 9)
+#define POWER_USER_TIM7 (1UL << 10)
+#define POWER_USER_TIM14 (1UL << 11)
+#define POWER_USER_TIM15 (1UL << 12)
+#define POWER_USER_TIM16 (1UL << 13)
+#define POWER_USER_TIM17 (1UL << 14)
+#define POWER_USER_APP(__N__) (1UL << (16 + (__N__))) // 0 - 15, free for the application
+	// Functions defined in "system_lowpower.c"
+	void power_require(uint32_t POWER_USER_x, uint8_t POWER_MODE_x); // replaces the previous requirement of the user
+	void power_release(uint32_t POWER_USER_x);
+	uint8_t power_getMode(void);				 // deepest mode allowed now
+	uint8_t system_idle(uint32_t deadline); // until millis() reaches deadline or an interrupt, returns the POWER_MODE_x used
+
+	/* Flash Functions *********************************/
+// Erase and program the pages after the program image. The functions return
+// FLASH_ERR_NONE or the FLASH_SR error flags and the FLASH_ERR_x bits below.
+// Unlock the flash first. Rows are programmed with fast programming (FSTPG),
+// the row must be in RAM and the interrupts are disabled while it's written.
+#ifndef FLASH_PAGE_SIZE
+#define FLASH_PAGE_SIZE 0x800U
+#endif
+#define FLASH_ROW_SIZE 256U					// 32 double-words
+#define FLASH_ERR_NONE 0x00000000U
+#define FLASH_ERR_TIMEOUT 0x80000000U // busy for more than FLASH_TIMEOUT_MS
+#define FLASH_ERR_ADDRESS 0x40000000U // misaligned, out of the flash or in a program page
+#define FLASH_ERR_BUSY 0x20000000U		// an asynchronous operation is running
+	typedef void (*flashCallback_t)(uint32_t error, void *ctx);
+	void flash_unlock(void);
+	void flash_lock(void); // deferred to the end of a running asynchronous operation
+	uint16_t flash_getPages(void);
+	uint16_t flash_getFirstFreePage(void); // first page after the program image
+	uint32_t flash_getPageAddress(uint16_t page);
+	uint16_t flash_getPage(uint32_t address);
+	uint32_t flash_erasePage(uint16_t page);
+	uint32_t flash_programDoubleWord(uint32_t address, uint64_t data); // 8-byte aligned
+	uint32_t flash_programRow(uint32_t address, const uint64_t *row);	 // FLASH_ROW_SIZE aligned
+// Asynchronous operations return after starting the first step and advance on
+// the FLASH interrupt. The callback (optional) is called from the interrupt
+// when they end. The flash is unlocked while they run. The CPU still stalls if
+// it reads the flash during a page erase, code and data in RAM keep running.
+	uint32_t flash_eraseAsync(uint16_t page, uint16_t count, flashCallback_t callback, void *ctx);
+	uint32_t flash_programAsync(uint32_t address, const uint64_t *data, uint16_t count, flashCallback_t callback, void *ctx); // data kept in memory while busy
+	bool flash_isBusy(void);
+	uint32_t flash_getError(void); // result of the last asynchronous operation
+
 	/* Virtual EEPROM Functions *********************************/
+// The data is kept in RAM. veeprom_commit() appends the changed words to a log
+// over the last VEEPROM_PAGES flash pages, a page is erased only when the log
+// is full and the data is compacted to the next page.
+#ifndef VEEPROM_SIZE
+#define VEEPROM_SIZE 512 // bytes, multiple of 8, up to 1016
+#endif
+#ifndef VEEPROM_PAGES
+#define VEEPROM_PAGES 2 // 2 KB pages at the end of the flash
+#endif
 	void veeprom_init(void);
 	uint8_t veeprom_writeByte(uint16_t address, uint8_t data);
 	uint8_t veeprom_writeHalfWord(uint16_t address, uint16_t data);
@@ -226,7 +356,8 @@ extern "C"
 	uint16_t veeprom_readHalfWord(uint16_t address);
 	uint32_t veeprom_readWord(uint16_t address);
 	void veeprom_readFloat(uint16_t address, float *rdata);
-	void veeprom_commit(void);
+	bool veeprom_isDirty(void); // true if there are writes not committed
+	void veeprom_commit(void);	// does nothing if veeprom_isDirty() is false
 	void veeprom_clear(void);
 
 #ifdef __cplusplus
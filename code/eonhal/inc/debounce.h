@@ -0,0 +1,109 @@
+/**
+  ******************************************************************************
+  * @file    debounce.h
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Input Debouncing Library
+  ******************************************************************************
+*/
+
+#ifndef __DEBOUNCE_H
+#define __DEBOUNCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pinmap_hal.h"
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Buttons and contacts are sampled every DEBOUNCE_PERIOD_MS by a software
+ * timer (stimer module), with a single IDR read per port. A pin changes its
+ * state after 4 equal samples, counted for all the pins of a port at once
+ * (vertical counter), so no EXTI is needed and bounces don't generate events.
+ *
+ *   void onButton(pin_t pin, uint8_t event, void *ctx) { ... }
+ *
+ *   debounce_init(onButton, NULL);
+ *   debounce_add(PA0, PULLUP, LOW); // pressed when the pin is LOW
+ *
+ * The callback is executed from the stimer interrupt.
+ */
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// Sample period, a change is accepted after 4 samples
+#ifndef DEBOUNCE_PERIOD_MS
+#define DEBOUNCE_PERIOD_MS 5
+#endif
+
+// Time pressed until DEBOUNCE_LONG_PRESS
+#ifndef DEBOUNCE_LONG_MS
+#define DEBOUNCE_LONG_MS 1000
+#endif
+
+// Different ports used by the debounced pins
+#ifndef DEBOUNCE_MAX_PORTS
+#define DEBOUNCE_MAX_PORTS 3
+#endif
+
+// Events
+#define DEBOUNCE_PRESS ((uint8_t)0x00)      /*!< Pin goes to its active level */
+#define DEBOUNCE_RELEASE ((uint8_t)0x01)    /*!< Pin goes back to its inactive level */
+#define DEBOUNCE_LONG_PRESS ((uint8_t)0x02) /*!< Pin active for DEBOUNCE_LONG_MS */
+
+/**
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+typedef void (*debounceCallback_t)(pin_t pin, uint8_t event, void *ctx);
+
+/**
+ ===============================================================================
+              ##### Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Start sampling the debounced pins (starts the stimer service too)
+ *
+ * @param {callback} Function called on each event
+ * @param {ctx} Argument passed to the callback
+ */
+void debounce_init(debounceCallback_t callback, void *ctx);
+
+/**
+ * @brief Configure a pin as input and debounce it
+ *
+ * @param {pin} Pin
+ * @param {pull} NOPULL, PULLDOWN or PULLUP
+ * @param {active} Level of the pressed state: HIGH or LOW
+ * @return {bool} false if there are already DEBOUNCE_MAX_PORTS ports in use
+ */
+bool debounce_add(pin_t pin, pull_t pull, uint8_t active);
+
+/**
+ * @brief Stop debouncing a pin
+ *
+ * @param {pin} Pin
+ */
+void debounce_remove(pin_t pin);
+
+/**
+ * @brief Get the debounced state of a pin
+ *
+ * @param {pin} Pin
+ * @return {bool} true if pressed
+ */
+bool debounce_isPressed(pin_t pin);
+
+#endif
@@ -72,4 +72,12 @@ uint16_t lowHalfWord(uint32_t w);
  */
 uint16_t highHalfWord(uint32_t w);
 
+/**
+ * @brief Get the index of the lowest bit set in a word
+ * 
+ * @param {w} word, must be different from 0 
+ * @return {uint8_t} bit index (0 - 31) 
+ */
+uint8_t lowestBitSet(uint32_t w);
+
 #endif
@@ -14,6 +14,28 @@
 #include "pinmap_hal.h"
 #include "stm32g0xx_ll_exti.h"
 
+/** 
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Fixed handlers: define USE_EXTIn (or USE_ALL_EXTI) and write IRQ_EXTIn().
+ *
+ * Callbacks: define USE_EXTI_CALLBACKS and register the handler of each pin at
+ * runtime with exti_attachCallback(). The interrupt only visits the pending
+ * lines, so its latency doesn't depend on the number of lines in use.
+ * USE_EXTIn handlers aren't used in this mode.
+ *
+ * Edge capture: define USE_EXTI_CAPTURE (implies USE_EXTI_CALLBACKS). The
+ * pins attached with exti_attachCapture() only store {pin, edge, micros()} in
+ * a queue from the interrupt, and the main loop reads them in batches with
+ * exti_captureRead().
+ */
+
+#if defined(USE_EXTI_CAPTURE) && !defined(USE_EXTI_CALLBACKS)
+#define USE_EXTI_CALLBACKS
+#endif
+
 /** 
  ===============================================================================
               ##### Definitions #####
@@ -25,6 +47,30 @@
 #define MODE_RISING LL_EXTI_TRIGGER_RISING
 #define MODE_FALLING LL_EXTI_TRIGGER_FALLING
 
+// Captured edges
+#define EXTI_EDGE_RISING 0
+#define EXTI_EDGE_FALLING 1
+
+// Captured edges queue length (power of 2)
+#ifndef EXTI_CAPTURE_SIZE
+#define EXTI_CAPTURE_SIZE 32
+#endif
+
+/** 
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+typedef void (*extiCallback_t)(void *ctx);
+
+typedef struct
+{
+  uint32_t timestamp; // micros() when the interrupt was served
+  pin_t pin;
+  uint8_t edge; // EXTI_EDGE_RISING or EXTI_EDGE_FALLING
+} exti_event_t;
+
 /** 
  ===============================================================================
               ##### Functions #####
@@ -37,6 +83,48 @@ void exti_detach(uint16_t pin);
 
 void exti_softTrigger(pin_t pin);
 
+#if defined(USE_EXTI_CALLBACKS)
+/**
+ * @brief Attach a pin interrupt with its callback (USE_EXTI_CALLBACKS)
+ * 
+ * @param {pin} Pin
+ * @param {pull} NOPULL, PULLDOWN or PULLUP
+ * @param {exti_mode} MODE_CHANGE, MODE_RISING or MODE_FALLING
+ * @param {callback} Function called from the interrupt
+ * @param {ctx} Argument passed to the callback
+ * @return {bool} false if the line is used by the same pin number of another port
+ */
+bool exti_attachCallback(pin_t pin, pull_t pull, uint8_t exti_mode, extiCallback_t callback, void *ctx);
+#endif
+
+#if defined(USE_EXTI_CAPTURE)
+/**
+ * @brief Attach a pin interrupt that queues the time of each edge (USE_EXTI_CAPTURE)
+ * 
+ * @param {pin} Pin
+ * @param {pull} NOPULL, PULLDOWN or PULLUP
+ * @param {exti_mode} MODE_CHANGE, MODE_RISING or MODE_FALLING
+ * @return {bool} false if the line is used by the same pin number of another port
+ */
+bool exti_attachCapture(pin_t pin, pull_t pull, uint8_t exti_mode);
+
+/**
+ * @brief Read the queued edges, oldest first
+ * 
+ * @param {events} Destination
+ * @param {max} Maximum number of events to be read
+ * @return {uint16_t} Number of events read
+ */
+uint16_t exti_captureRead(exti_event_t *events, uint16_t max);
+
+/**
+ * @brief Get the edges lost because the queue was full, and clear the count
+ * 
+ * @return {uint32_t} Lost edges
+ */
+uint32_t exti_captureLost(void);
+#endif
+
 // Interruptions
 #if defined(USE_EXTI0) || defined(USE_ALL_EXTI)
 #define IRQ_EXTI0() void __EXTI0(void)
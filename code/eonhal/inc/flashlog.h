@@ -0,0 +1,142 @@
+/**
+  ******************************************************************************
+  * @file    flashlog.h
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Flash Data Logger Library
+  ******************************************************************************
+*/
+
+#ifndef __FLASHLOG_H
+#define __FLASHLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Records of any size are appended to a ring of flash pages, tagged with
+ * rtc_getUnix() and a CRC. They are collected in a RAM row and written 256
+ * bytes at a time with fast programming. When the ring is full the oldest
+ * page is erased, so each page is erased once per turn of the ring.
+ *
+ * At boot the newest page is found by a binary search over the page
+ * sequence numbers, and the next free row by a binary search in that page.
+ *
+ *   flashlog_init(flash_getPages() - VEEPROM_PAGES - 16, 16); // 32 KB
+ *   flashlog_write(&sample, sizeof(sample));
+ *   ...
+ *   flashlog_flush();
+ *   flashlog_dump(uart1_write);
+ *
+ * A record never crosses a row: the free bytes at the end of a row are
+ * skipped, and flashlog_flush() writes a partial row (the rest of it is lost).
+ * Records still in the RAM row are lost on a reset.
+ *
+ * Dumped records are sent as stored: {unix (4), length (1), 0xFF (1),
+ * check (2), data}, little endian. The check is the 16 low bits of the
+ * CRC-32 (0x04C11DB7, init 0xFFFFFFFF) of unix, length and data.
+ */
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+#define FLASHLOG_HEADER 8																		// record header bytes
+#define FLASHLOG_MAX_LENGTH (256 - 8 - FLASHLOG_HEADER) // a row less the page and record headers
+
+/**
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Read position, its fields are private
+ */
+typedef struct
+{
+  uint32_t seq; // sequence of the page
+  uint16_t page;
+  uint16_t offset;
+} flashlog_cursor_t;
+
+/**
+ * @brief Record read from the log
+ */
+typedef struct
+{
+  uint32_t unix;
+  const uint8_t *data; // points to the flash
+  uint8_t length;
+} flashlog_record_t;
+
+/**
+ ===============================================================================
+              ##### Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Find the end of the log in its pages
+ *
+ * @param {first_page} First page of the log, after the program
+ * @param {pages} Number of pages (2 or more)
+ * @return {bool} false if the pages aren't free flash pages
+ */
+bool flashlog_init(uint16_t first_page, uint16_t pages);
+
+/**
+ * @brief Append a record, it's written to the flash when its row is full
+ *
+ * @param {data} Data
+ * @param {length} Data length (1 - FLASHLOG_MAX_LENGTH)
+ * @return {bool} false if the length isn't valid or the flash failed
+ */
+bool flashlog_write(const void *data, uint8_t length);
+
+/**
+ * @brief Write the records of the RAM row to the flash
+ *
+ * @return {bool} false if the flash failed
+ */
+bool flashlog_flush(void);
+
+/**
+ * @brief Erase all the records
+ */
+void flashlog_erase(void);
+
+/**
+ * @brief Set the cursor to the oldest record
+ *
+ * @param {cursor} Cursor
+ */
+void flashlog_rewind(flashlog_cursor_t *cursor);
+
+/**
+ * @brief Read the record at the cursor and advance it. Records with a bad
+ * check are skipped. If the page of the cursor was overwritten, it
+ * continues from the oldest record.
+ *
+ * @param {cursor} Cursor
+ * @param {record} Record read
+ * @return {bool} false if there are no more records in the flash
+ */
+bool flashlog_read(flashlog_cursor_t *cursor, flashlog_record_t *record);
+
+/**
+ * @brief Send all the records, as stored, from the oldest one
+ *
+ * @param {write} Byte output function, like uart1_write
+ * @return {uint32_t} Records sent
+ */
+uint32_t flashlog_dump(void (*write)(unsigned char c));
+
+#endif
@@ -50,6 +50,35 @@
 #define PULLUP ((uint8_t)0x01)   /*!< Pull-up activation                  */
 #define PULLDOWN ((uint8_t)0x02) /*!< Pull-down activation                */
 
+// **** Pin groups
+#ifndef GPIO_GROUP_MAX_PINS
+#define GPIO_GROUP_MAX_PINS 16 /*!< Bits of the value written to a group */
+#endif
+#ifndef GPIO_GROUP_MAX_PORTS
+#define GPIO_GROUP_MAX_PORTS 3 /*!< Different ports a group can use */
+#endif
+
+/** 
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Group of pins written and read as a single value (parallel bus).
+ * Bit 0 of the value is the first pin. Its fields are private.
+ */
+typedef struct
+{
+  GPIO_TypeDef *GPIOx[GPIO_GROUP_MAX_PORTS];
+  uint16_t mask[GPIO_GROUP_MAX_PORTS]; // pins of the group on each port
+  uint16_t pin[GPIO_GROUP_MAX_PINS];   // pin mask of each value bit
+  uint8_t port[GPIO_GROUP_MAX_PINS];   // port index of each value bit
+  uint8_t ports;
+  uint8_t count;
+  int8_t shift; // >= 0 if the value bits are consecutive pins of one port
+} gpio_group_t;
+
 /** 
  ===============================================================================
               ##### Public Functions #####
@@ -134,6 +163,101 @@ void gpio_toggle(pin_t pin);
  */
 uint8_t gpio_read(pin_t pin);
 
+/** 
+ ===============================================================================
+              ##### Port Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Get the port of the specified pin
+ * 
+ * @param {pin} Pin
+ * @return {GPIO_TypeDef *} GPIOA, GPIOB, ...
+ */
+GPIO_TypeDef *gpio_port(pin_t pin);
+
+/**
+ * @brief Get the mask of the specified pin in its port
+ * 
+ * @param {pin} Pin
+ * @return {uint16_t} Pin mask (1 << pin number)
+ */
+uint16_t gpio_pinMask(pin_t pin);
+
+/**
+ * @brief Write the masked pins of a port in one store (atomic)
+ * 
+ * @param {GPIOx} Port: GPIOA, GPIOB, ...
+ * @param {mask} Pins to be written
+ * @param {value} State of each pin of the mask
+ */
+__STATIC_INLINE void gpio_portWrite(GPIO_TypeDef *GPIOx, uint16_t mask, uint16_t value)
+{
+  GPIOx->BSRR = ((uint32_t)(mask & ~value) << 16) | (mask & value);
+}
+
+/**
+ * @brief Read the masked pins of a port
+ * 
+ * @param {GPIOx} Port: GPIOA, GPIOB, ...
+ * @param {mask} Pins to be read
+ * @return {uint16_t} State of the pins, other bits are 0
+ */
+__STATIC_INLINE uint16_t gpio_portRead(GPIO_TypeDef *GPIOx, uint16_t mask)
+{
+  return (uint16_t)(GPIOx->IDR & mask);
+}
+
+/**
+ * @brief Toggle the masked pins of a port, other pins aren't touched
+ * even if an interrupt writes them at the same time
+ * 
+ * @param {GPIOx} Port: GPIOA, GPIOB, ...
+ * @param {mask} Pins to be toggled
+ */
+__STATIC_INLINE void gpio_portToggle(GPIO_TypeDef *GPIOx, uint16_t mask)
+{
+  uint32_t odr = GPIOx->ODR;
+  GPIOx->BSRR = ((odr & mask) << 16) | (~odr & mask);
+}
+
+/**
+ * @brief Resolve a list of pins into a group
+ * 
+ * @param {group} Group handle
+ * @param {pins} Pins, the first one is bit 0 of the value
+ * @param {count} Number of pins (up to GPIO_GROUP_MAX_PINS)
+ * @return {bool} false if there are too many pins or ports
+ */
+bool gpio_groupInit(gpio_group_t *group, const pin_t *pins, uint8_t count);
+
+/**
+ * @brief Configure all the pins of a group
+ * 
+ * @param {group} Group handle
+ * @param {mode} INPUT, ANALOG, OUTPUT_PP or OUTPUT_OD
+ * @param {pull} NOPULL, PULLDOWN or PULLUP 
+ * @param {speed} SPEED_LOW, SPEED_MEDIUM, SPEED_HIGH, SPEED_VER_HIGH
+ */
+void gpio_groupMode(gpio_group_t *group, mode_t mode, pull_t pull, speed_t speed);
+
+/**
+ * @brief Write a value to a group, one store per port
+ * 
+ * @param {group} Group handle
+ * @param {value} Value, bit n is written to the pin n of the group
+ */
+void gpio_groupWrite(gpio_group_t *group, uint16_t value);
+
+/**
+ * @brief Read the value of a group
+ * 
+ * @param {group} Group handle
+ * @return {uint16_t} Value, bit n is the state of the pin n of the group
+ */
+uint16_t gpio_groupRead(gpio_group_t *group);
+
 #include "pinmap_impl.h"
 /**
  * @brief Switch the pin state to HIGH
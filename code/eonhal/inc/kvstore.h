@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    kvstore.h
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Key-Value Store Library
+  ******************************************************************************
+*/
+
+#ifndef __KVSTORE_H
+#define __KVSTORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Values are stored by key in a window of the virtual EEPROM, instead of at
+ * fixed addresses. Each update is appended as a record {key, length, CRC,
+ * value}, so veeprom_commit() only writes the words of that record. A record
+ * torn by a reset during the commit fails its CRC and the previous value of
+ * the key is kept. When the window is full the live records are compacted.
+ * An index of the keys in RAM, built by kvstore_init(), finds any key
+ * without scanning the records.
+ *
+ *   veeprom_init();
+ *   kvstore_init();
+ *   kvstore_set(KEY_BAUDRATE, &baud, sizeof(baud));
+ *   veeprom_commit();
+ *
+ * The window (KVSTORE_ADDRESS, KVSTORE_SIZE) must not be used with the
+ * veeprom_write* functions.
+ */
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// Window of the virtual EEPROM used by the store (multiples of 4)
+#ifndef KVSTORE_ADDRESS
+#define KVSTORE_ADDRESS 0
+#endif
+#ifndef KVSTORE_SIZE
+#define KVSTORE_SIZE VEEPROM_SIZE
+#endif
+
+// Keys in the RAM index (power of 2), one more than the keys used
+#ifndef KVSTORE_INDEX_SIZE
+#define KVSTORE_INDEX_SIZE 32
+#endif
+
+#define KVSTORE_KEY_NONE 0xFFFF // reserved
+#define KVSTORE_MAX_LENGTH 255
+
+/**
+ ===============================================================================
+              ##### Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Build the key index from the records, call it after veeprom_init()
+ */
+void kvstore_init(void);
+
+/**
+ * @brief Set the value of a key, nothing is written if it's the same value
+ *
+ * @param {key} Key (0 - 0xFFFE)
+ * @param {value} Value
+ * @param {length} Value length (1 - KVSTORE_MAX_LENGTH)
+ * @return {bool} false if there's no space for the value or for a new key
+ */
+bool kvstore_set(uint16_t key, const void *value, uint8_t length);
+
+/**
+ * @brief Get the value of a key
+ *
+ * @param {key} Key
+ * @param {value} Destination
+ * @param {max_length} Size of the destination, a longer value is truncated
+ * @return {uint8_t} Value length, 0 if the key doesn't exist
+ */
+uint8_t kvstore_get(uint16_t key, void *value, uint8_t max_length);
+
+/**
+ * @brief Delete a key
+ *
+ * @param {key} Key
+ */
+void kvstore_delete(uint16_t key);
+
+/**
+ * @brief Get the free space of the window (after compacting the records)
+ *
+ * @return {uint16_t} Bytes
+ */
+uint16_t kvstore_free(void);
+
+#endif
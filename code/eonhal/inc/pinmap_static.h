@@ -0,0 +1,729 @@
+/**
+ ******************************************************************************
+ * @file    pinmap_static.h
+ * @version V1.0.1
+ * @date    2019
+ * @brief   Compile time pin map
+ ******************************************************************************
+ */
+
+#ifndef __PINMAP_STATIC_H
+#define __PINMAP_STATIC_H
+
+#include "stm32g0xx_ll_gpio.h"
+#include "stm32g0xx_ll_tim.h"
+#include "stm32g0xx_ll_adc.h"
+#include "gpio.h"
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Same information as HAL_Pin_Map(), resolved by the preprocessor when the pin
+ * is a constant (PA5, AN_PA5, or a #define of them), so there's no table
+ * lookup and the calls can be inlined:
+ *
+ *   pin_set(PA5);                       // GPIOA->BSRR = LL_GPIO_PIN_5
+ *   if (pin_read(PC13)) ...
+ *   LL_ADC_REG_SetSequencerChannels(ADC1, PIN_ADC(PA0));
+ *
+ * A pin without the requested function doesn't compile, e.g. PIN_TIM(PA5)
+ * gives "PINMAP_A5_TIM undeclared". Pins that are only known at runtime
+ * keep using gpio_write(), pwm_write(), adc_read()...
+ */
+
+/**
+ ===============================================================================
+              ##### Pin Functions #####
+ ===============================================================================
+ */
+
+#define PIN_PORT(__PIN__) PINMAP_GET(__PIN__, _PORT)      /*!< GPIOx */
+#define PIN_MASK(__PIN__) PINMAP_GET(__PIN__, _PIN)       /*!< LL_GPIO_PIN_x */
+#define PIN_ADC(__PIN__) PINMAP_GET(__PIN__, _ADC)        /*!< LL_ADC_CHANNEL_x */
+#define PIN_TIM(__PIN__) PINMAP_GET(__PIN__, _TIM)        /*!< TIMx */
+#define PIN_TIM_CH(__PIN__) PINMAP_GET(__PIN__, _TIMCH)   /*!< LL_TIM_CHANNEL_CHx */
+#define PIN_TIM_AF(__PIN__) PINMAP_GET(__PIN__, _TIMAF)   /*!< AF_x of the timer */
+#define PIN_SPI_AF(__PIN__) PINMAP_GET(__PIN__, _SPIAF)   /*!< AF_x of the SPI */
+#define PIN_I2C_AF(__PIN__) PINMAP_GET(__PIN__, _I2CAF)   /*!< AF_x of the I2C */
+#define PIN_UART_AF(__PIN__) PINMAP_GET(__PIN__, _UARTAF) /*!< AF_x of the UART */
+
+#define pin_set(__PIN__) (PIN_PORT(__PIN__)->BSRR = PIN_MASK(__PIN__))
+#define pin_reset(__PIN__) (PIN_PORT(__PIN__)->BRR = PIN_MASK(__PIN__))
+#define pin_write(__PIN__, __STATE__) gpio_portWrite(PIN_PORT(__PIN__), PIN_MASK(__PIN__), (__STATE__) ? PIN_MASK(__PIN__) : 0)
+#define pin_toggle(__PIN__) gpio_portToggle(PIN_PORT(__PIN__), PIN_MASK(__PIN__))
+#define pin_read(__PIN__) ((PIN_PORT(__PIN__)->IDR & PIN_MASK(__PIN__)) == 0 ? LOW : HIGH)
+#define pin_modePWM(__PIN__) gpio_modeAF(__PIN__, AF_PP, NOPULL, PIN_TIM_AF(__PIN__))
+
+// The pin number is expanded first, then its name is pasted with the field
+#define PINMAP_GET(__PIN__, __FIELD__) PINMAP_CAT(PINMAP_, PINMAP_NAME(__PIN__), __FIELD__)
+#define PINMAP_NAME(__PIN__) PINMAP_NAME2(__PIN__)
+#define PINMAP_NAME2(__ID__) PINMAP_ID_##__ID__
+#define PINMAP_CAT(__A__, __B__, __C__) PINMAP_CAT2(__A__, __B__, __C__)
+#define PINMAP_CAT2(__A__, __B__, __C__) __A__##__B__##__C__
+
+/**
+ ===============================================================================
+              ##### Pin Numbers #####
+ ===============================================================================
+ */
+
+#if defined(STM32G070KB)
+#define PINMAP_ID_0 A0
+#define PINMAP_ID_1 A1
+#define PINMAP_ID_2 A2
+#define PINMAP_ID_3 A3
+#define PINMAP_ID_4 A4
+#define PINMAP_ID_5 A5
+#define PINMAP_ID_6 A6
+#define PINMAP_ID_7 A7
+#define PINMAP_ID_8 A8
+#define PINMAP_ID_9 A9
+#define PINMAP_ID_10 A10
+#define PINMAP_ID_11 A11
+#define PINMAP_ID_12 A12
+#define PINMAP_ID_13 A13
+#define PINMAP_ID_14 A15
+#define PINMAP_ID_15 B0
+#define PINMAP_ID_16 B1
+#define PINMAP_ID_17 B2
+#define PINMAP_ID_18 B3
+#define PINMAP_ID_19 B4
+#define PINMAP_ID_20 B5
+#define PINMAP_ID_21 B6
+#define PINMAP_ID_22 B7
+#define PINMAP_ID_23 B8
+#define PINMAP_ID_24 B9
+#define PINMAP_ID_25 C6
+#define PINMAP_ID_26 C14
+#define PINMAP_ID_27 C15
+#endif
+
+#if defined(STM32G070CB)
+#define PINMAP_ID_0 A0
+#define PINMAP_ID_1 A1
+#define PINMAP_ID_2 A2
+#define PINMAP_ID_3 A3
+#define PINMAP_ID_4 A4
+#define PINMAP_ID_5 A5
+#define PINMAP_ID_6 A6
+#define PINMAP_ID_7 A7
+#define PINMAP_ID_8 A8
+#define PINMAP_ID_9 A9
+#define PINMAP_ID_10 A10
+#define PINMAP_ID_11 A11
+#define PINMAP_ID_12 A12
+#define PINMAP_ID_13 A13
+#define PINMAP_ID_14 A15
+#define PINMAP_ID_15 B0
+#define PINMAP_ID_16 B1
+#define PINMAP_ID_17 B2
+#define PINMAP_ID_18 B3
+#define PINMAP_ID_19 B4
+#define PINMAP_ID_20 B5
+#define PINMAP_ID_21 B6
+#define PINMAP_ID_22 B7
+#define PINMAP_ID_23 B8
+#define PINMAP_ID_24 B9
+#define PINMAP_ID_25 B10
+#define PINMAP_ID_26 B11
+#define PINMAP_ID_27 B12
+#define PINMAP_ID_28 B13
+#define PINMAP_ID_29 B14
+#define PINMAP_ID_30 B15
+#define PINMAP_ID_31 C6
+#define PINMAP_ID_32 C7
+#define PINMAP_ID_33 C13
+#define PINMAP_ID_34 C14
+#define PINMAP_ID_35 C15
+#define PINMAP_ID_36 D0
+#define PINMAP_ID_37 D1
+#define PINMAP_ID_38 D2
+#define PINMAP_ID_39 D3
+#define PINMAP_ID_40 F0
+#define PINMAP_ID_41 F1
+#endif
+
+#if defined(STM32G070RB) || defined(STM32G071RB)
+#define PINMAP_ID_0 A0
+#define PINMAP_ID_1 A1
+#define PINMAP_ID_2 A2
+#define PINMAP_ID_3 A3
+#define PINMAP_ID_4 A4
+#define PINMAP_ID_5 A5
+#define PINMAP_ID_6 A6
+#define PINMAP_ID_7 A7
+#define PINMAP_ID_8 A8
+#define PINMAP_ID_9 A9
+#define PINMAP_ID_10 A10
+#define PINMAP_ID_11 A11
+#define PINMAP_ID_12 A12
+#define PINMAP_ID_13 A13
+#define PINMAP_ID_14 A15
+#define PINMAP_ID_15 B0
+#define PINMAP_ID_16 B1
+#define PINMAP_ID_17 B2
+#define PINMAP_ID_18 B3
+#define PINMAP_ID_19 B4
+#define PINMAP_ID_20 B5
+#define PINMAP_ID_21 B6
+#define PINMAP_ID_22 B7
+#define PINMAP_ID_23 B8
+#define PINMAP_ID_24 B9
+#define PINMAP_ID_25 B10
+#define PINMAP_ID_26 B11
+#define PINMAP_ID_27 B12
+#define PINMAP_ID_28 B13
+#define PINMAP_ID_29 B14
+#define PINMAP_ID_30 B15
+#define PINMAP_ID_31 C0
+#define PINMAP_ID_32 C1
+#define PINMAP_ID_33 C2
+#define PINMAP_ID_34 C3
+#define PINMAP_ID_35 C4
+#define PINMAP_ID_36 C5
+#define PINMAP_ID_37 C6
+#define PINMAP_ID_38 C7
+#define PINMAP_ID_39 C8
+#define PINMAP_ID_40 C9
+#define PINMAP_ID_41 C10
+#define PINMAP_ID_42 C11
+#define PINMAP_ID_43 C12
+#define PINMAP_ID_44 C13
+#define PINMAP_ID_45 C14
+#define PINMAP_ID_46 C15
+#define PINMAP_ID_47 D0
+#define PINMAP_ID_48 D1
+#define PINMAP_ID_49 D2
+#define PINMAP_ID_50 D3
+#define PINMAP_ID_51 D4
+#define PINMAP_ID_52 D5
+#define PINMAP_ID_53 D6
+#define PINMAP_ID_54 D8
+#define PINMAP_ID_55 D9
+#define PINMAP_ID_56 F0
+#define PINMAP_ID_57 F1
+#endif
+
+/**
+ ===============================================================================
+              ##### Pins #####
+ ===============================================================================
+ */
+
+#define PINMAP_A0_PORT GPIOA
+#define PINMAP_A0_PIN LL_GPIO_PIN_0
+#define PINMAP_A1_PORT GPIOA
+#define PINMAP_A1_PIN LL_GPIO_PIN_1
+#define PINMAP_A2_PORT GPIOA
+#define PINMAP_A2_PIN LL_GPIO_PIN_2
+#define PINMAP_A3_PORT GPIOA
+#define PINMAP_A3_PIN LL_GPIO_PIN_3
+#define PINMAP_A4_PORT GPIOA
+#define PINMAP_A4_PIN LL_GPIO_PIN_4
+#define PINMAP_A5_PORT GPIOA
+#define PINMAP_A5_PIN LL_GPIO_PIN_5
+#define PINMAP_A6_PORT GPIOA
+#define PINMAP_A6_PIN LL_GPIO_PIN_6
+#define PINMAP_A7_PORT GPIOA
+#define PINMAP_A7_PIN LL_GPIO_PIN_7
+#define PINMAP_A8_PORT GPIOA
+#define PINMAP_A8_PIN LL_GPIO_PIN_8
+#define PINMAP_A9_PORT GPIOA
+#define PINMAP_A9_PIN LL_GPIO_PIN_9
+#define PINMAP_A10_PORT GPIOA
+#define PINMAP_A10_PIN LL_GPIO_PIN_10
+#define PINMAP_A11_PORT GPIOA
+#define PINMAP_A11_PIN LL_GPIO_PIN_11
+#define PINMAP_A12_PORT GPIOA
+#define PINMAP_A12_PIN LL_GPIO_PIN_12
+#define PINMAP_A13_PORT GPIOA
+#define PINMAP_A13_PIN LL_GPIO_PIN_13
+#define PINMAP_A15_PORT GPIOA
+#define PINMAP_A15_PIN LL_GPIO_PIN_15
+#define PINMAP_B0_PORT GPIOB
+#define PINMAP_B0_PIN LL_GPIO_PIN_0
+#define PINMAP_B1_PORT GPIOB
+#define PINMAP_B1_PIN LL_GPIO_PIN_1
+#define PINMAP_B2_PORT GPIOB
+#define PINMAP_B2_PIN LL_GPIO_PIN_2
+#define PINMAP_B3_PORT GPIOB
+#define PINMAP_B3_PIN LL_GPIO_PIN_3
+#define PINMAP_B4_PORT GPIOB
+#define PINMAP_B4_PIN LL_GPIO_PIN_4
+#define PINMAP_B5_PORT GPIOB
+#define PINMAP_B5_PIN LL_GPIO_PIN_5
+#define PINMAP_B6_PORT GPIOB
+#define PINMAP_B6_PIN LL_GPIO_PIN_6
+#define PINMAP_B7_PORT GPIOB
+#define PINMAP_B7_PIN LL_GPIO_PIN_7
+#define PINMAP_B8_PORT GPIOB
+#define PINMAP_B8_PIN LL_GPIO_PIN_8
+#define PINMAP_B9_PORT GPIOB
+#define PINMAP_B9_PIN LL_GPIO_PIN_9
+#define PINMAP_B10_PORT GPIOB
+#define PINMAP_B10_PIN LL_GPIO_PIN_10
+#define PINMAP_B11_PORT GPIOB
+#define PINMAP_B11_PIN LL_GPIO_PIN_11
+#define PINMAP_B12_PORT GPIOB
+#define PINMAP_B12_PIN LL_GPIO_PIN_12
+#define PINMAP_B13_PORT GPIOB
+#define PINMAP_B13_PIN LL_GPIO_PIN_13
+#define PINMAP_B14_PORT GPIOB
+#define PINMAP_B14_PIN LL_GPIO_PIN_14
+#define PINMAP_B15_PORT GPIOB
+#define PINMAP_B15_PIN LL_GPIO_PIN_15
+#define PINMAP_C0_PORT GPIOC
+#define PINMAP_C0_PIN LL_GPIO_PIN_0
+#define PINMAP_C1_PORT GPIOC
+#define PINMAP_C1_PIN LL_GPIO_PIN_1
+#define PINMAP_C2_PORT GPIOC
+#define PINMAP_C2_PIN LL_GPIO_PIN_2
+#define PINMAP_C3_PORT GPIOC
+#define PINMAP_C3_PIN LL_GPIO_PIN_3
+#define PINMAP_C4_PORT GPIOC
+#define PINMAP_C4_PIN LL_GPIO_PIN_4
+#define PINMAP_C5_PORT GPIOC
+#define PINMAP_C5_PIN LL_GPIO_PIN_5
+#define PINMAP_C6_PORT GPIOC
+#define PINMAP_C6_PIN LL_GPIO_PIN_6
+#define PINMAP_C7_PORT GPIOC
+#define PINMAP_C7_PIN LL_GPIO_PIN_7
+#define PINMAP_C8_PORT GPIOC
+#define PINMAP_C8_PIN LL_GPIO_PIN_8
+#define PINMAP_C9_PORT GPIOC
+#define PINMAP_C9_PIN LL_GPIO_PIN_9
+#define PINMAP_C10_PORT GPIOC
+#define PINMAP_C10_PIN LL_GPIO_PIN_10
+#define PINMAP_C11_PORT GPIOC
+#define PINMAP_C11_PIN LL_GPIO_PIN_11
+#define PINMAP_C12_PORT GPIOC
+#define PINMAP_C12_PIN LL_GPIO_PIN_12
+#define PINMAP_C13_PORT GPIOC
+#define PINMAP_C13_PIN LL_GPIO_PIN_13
+#define PINMAP_C14_PORT GPIOC
+#define PINMAP_C14_PIN LL_GPIO_PIN_14
+#define PINMAP_C15_PORT GPIOC
+#define PINMAP_C15_PIN LL_GPIO_PIN_15
+#define PINMAP_D0_PORT GPIOD
+#define PINMAP_D0_PIN LL_GPIO_PIN_0
+#define PINMAP_D1_PORT GPIOD
+#define PINMAP_D1_PIN LL_GPIO_PIN_1
+#define PINMAP_D2_PORT GPIOD
+#define PINMAP_D2_PIN LL_GPIO_PIN_2
+#define PINMAP_D3_PORT GPIOD
+#define PINMAP_D3_PIN LL_GPIO_PIN_3
+#define PINMAP_D4_PORT GPIOD
+#define PINMAP_D4_PIN LL_GPIO_PIN_4
+#define PINMAP_D5_PORT GPIOD
+#define PINMAP_D5_PIN LL_GPIO_PIN_5
+#define PINMAP_D6_PORT GPIOD
+#define PINMAP_D6_PIN LL_GPIO_PIN_6
+#define PINMAP_D8_PORT GPIOD
+#define PINMAP_D8_PIN LL_GPIO_PIN_8
+#define PINMAP_D9_PORT GPIOD
+#define PINMAP_D9_PIN LL_GPIO_PIN_9
+#define PINMAP_F0_PORT GPIOF
+#define PINMAP_F0_PIN LL_GPIO_PIN_0
+#define PINMAP_F1_PORT GPIOF
+#define PINMAP_F1_PIN LL_GPIO_PIN_1
+
+#if defined(STM32G070xx)
+#define PINMAP_A0_ADC LL_ADC_CHANNEL_0
+#define PINMAP_A0_SPIAF AF_0
+#define PINMAP_A0_UARTAF AF_4
+#define PINMAP_A1_ADC LL_ADC_CHANNEL_1
+#define PINMAP_A1_SPIAF AF_0
+#define PINMAP_A1_UARTAF AF_4
+#define PINMAP_A2_ADC LL_ADC_CHANNEL_2
+#define PINMAP_A2_TIM TIM15
+#define PINMAP_A2_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A2_TIMAF AF_5
+#define PINMAP_A2_SPIAF AF_0
+#define PINMAP_A2_UARTAF AF_1
+#define PINMAP_A3_ADC LL_ADC_CHANNEL_3
+#define PINMAP_A3_TIM TIM15
+#define PINMAP_A3_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_A3_TIMAF AF_5
+#define PINMAP_A3_SPIAF AF_0
+#define PINMAP_A3_UARTAF AF_1
+#define PINMAP_A4_ADC LL_ADC_CHANNEL_4
+#define PINMAP_A4_TIM TIM14
+#define PINMAP_A4_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A4_TIMAF AF_4
+#define PINMAP_A4_SPIAF AF_1
+#define PINMAP_A5_ADC LL_ADC_CHANNEL_5
+#define PINMAP_A5_SPIAF AF_0
+#define PINMAP_A5_UARTAF AF_4
+#define PINMAP_A6_ADC LL_ADC_CHANNEL_6
+#define PINMAP_A6_TIM TIM16
+#define PINMAP_A6_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A6_TIMAF AF_5
+#define PINMAP_A6_SPIAF AF_0
+#define PINMAP_A7_ADC LL_ADC_CHANNEL_7
+#define PINMAP_A7_TIM TIM17
+#define PINMAP_A7_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A7_TIMAF AF_5
+#define PINMAP_A7_SPIAF AF_0
+#define PINMAP_A8_TIM TIM1
+#define PINMAP_A8_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A8_TIMAF AF_2
+#define PINMAP_A8_SPIAF AF_1
+#define PINMAP_A9_TIM TIM1
+#define PINMAP_A9_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_A9_TIMAF AF_2
+#define PINMAP_A9_I2CAF AF_6
+#define PINMAP_A9_UARTAF AF_1
+#define PINMAP_A10_TIM TIM1
+#define PINMAP_A10_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_A10_TIMAF AF_2
+#define PINMAP_A10_SPIAF AF_0
+#define PINMAP_A10_I2CAF AF_6
+#define PINMAP_A10_UARTAF AF_1
+#define PINMAP_A11_TIM TIM1
+#define PINMAP_A11_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_A11_TIMAF AF_2
+#define PINMAP_A11_SPIAF AF_0
+#define PINMAP_A11_I2CAF AF_6
+#define PINMAP_A12_SPIAF AF_0
+#define PINMAP_A12_I2CAF AF_6
+#define PINMAP_A12_UARTAF AF_1
+#define PINMAP_A15_SPIAF AF_0
+#define PINMAP_A15_UARTAF AF_1
+#define PINMAP_B0_ADC LL_ADC_CHANNEL_8
+#define PINMAP_B0_TIM TIM3
+#define PINMAP_B0_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_B0_TIMAF AF_1
+#define PINMAP_B0_SPIAF AF_0
+#define PINMAP_B0_UARTAF AF_4
+#define PINMAP_B1_ADC LL_ADC_CHANNEL_9
+#define PINMAP_B1_TIM TIM3
+#define PINMAP_B1_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_B1_TIMAF AF_1
+#define PINMAP_B1_UARTAF AF_4
+#define PINMAP_B2_ADC LL_ADC_CHANNEL_10
+#define PINMAP_B2_SPIAF AF_1
+#define PINMAP_B2_UARTAF AF_4
+#define PINMAP_B3_TIM TIM1
+#define PINMAP_B3_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_B3_TIMAF AF_1
+#define PINMAP_B3_SPIAF AF_0
+#define PINMAP_B3_UARTAF AF_4
+#define PINMAP_B4_TIM TIM3
+#define PINMAP_B4_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B4_TIMAF AF_1
+#define PINMAP_B4_SPIAF AF_0
+#define PINMAP_B5_TIM TIM3
+#define PINMAP_B5_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_B5_TIMAF AF_1
+#define PINMAP_B5_SPIAF AF_0
+#define PINMAP_B6_TIM TIM1
+#define PINMAP_B6_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_B6_TIMAF AF_1
+#define PINMAP_B6_SPIAF AF_4
+#define PINMAP_B6_I2CAF AF_6
+#define PINMAP_B6_UARTAF AF_0
+#define PINMAP_B7_SPIAF AF_1
+#define PINMAP_B7_I2CAF AF_6
+#define PINMAP_B7_UARTAF AF_0
+#define PINMAP_B8_TIM TIM16
+#define PINMAP_B8_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B8_TIMAF AF_2
+#define PINMAP_B8_SPIAF AF_1
+#define PINMAP_B8_I2CAF AF_6
+#define PINMAP_B8_UARTAF AF_4
+#define PINMAP_B9_TIM TIM17
+#define PINMAP_B9_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B9_TIMAF AF_2
+#define PINMAP_B9_SPIAF AF_5
+#define PINMAP_B9_I2CAF AF_6
+#define PINMAP_B9_UARTAF AF_4
+#define PINMAP_B10_ADC LL_ADC_CHANNEL_11
+#define PINMAP_B10_SPIAF AF_5
+#define PINMAP_B10_I2CAF AF_6
+#define PINMAP_B10_UARTAF AF_4
+#define PINMAP_B11_ADC LL_ADC_CHANNEL_15
+#define PINMAP_B11_SPIAF AF_0
+#define PINMAP_B11_I2CAF AF_6
+#define PINMAP_B11_UARTAF AF_4
+#define PINMAP_B12_ADC LL_ADC_CHANNEL_16
+#define PINMAP_B12_SPIAF AF_0
+#define PINMAP_B13_SPIAF AF_0
+#define PINMAP_B13_I2CAF AF_6
+#define PINMAP_B14_TIM TIM15
+#define PINMAP_B14_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B14_TIMAF AF_5
+#define PINMAP_B14_SPIAF AF_0
+#define PINMAP_B14_I2CAF AF_6
+#define PINMAP_B14_UARTAF AF_4
+#define PINMAP_B15_TIM TIM15
+#define PINMAP_B15_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_B15_TIMAF AF_5
+#define PINMAP_B15_SPIAF AF_0
+#define PINMAP_C1_TIM TIM15
+#define PINMAP_C1_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C1_TIMAF AF_2
+#define PINMAP_C2_TIM TIM15
+#define PINMAP_C2_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C2_TIMAF AF_2
+#define PINMAP_C2_SPIAF AF_1
+#define PINMAP_C3_SPIAF AF_1
+#define PINMAP_C4_ADC LL_ADC_CHANNEL_17
+#define PINMAP_C4_UARTAF AF_1
+#define PINMAP_C5_ADC LL_ADC_CHANNEL_18
+#define PINMAP_C5_UARTAF AF_1
+#define PINMAP_C6_TIM TIM3
+#define PINMAP_C6_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C6_TIMAF AF_1
+#define PINMAP_C7_TIM TIM3
+#define PINMAP_C7_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C7_TIMAF AF_1
+#define PINMAP_C8_TIM TIM1
+#define PINMAP_C8_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C8_TIMAF AF_2
+#define PINMAP_C9_TIM TIM1
+#define PINMAP_C9_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C9_TIMAF AF_2
+#define PINMAP_C10_TIM TIM1
+#define PINMAP_C10_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_C10_TIMAF AF_2
+#define PINMAP_C10_UARTAF AF_0
+#define PINMAP_C11_TIM TIM1
+#define PINMAP_C11_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_C11_TIMAF AF_2
+#define PINMAP_C11_UARTAF AF_0
+#define PINMAP_C12_TIM TIM14
+#define PINMAP_C12_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C12_TIMAF AF_2
+#define PINMAP_D0_TIM TIM16
+#define PINMAP_D0_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_D0_TIMAF AF_2
+#define PINMAP_D0_SPIAF AF_1
+#define PINMAP_D1_TIM TIM17
+#define PINMAP_D1_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_D1_TIMAF AF_2
+#define PINMAP_D1_SPIAF AF_1
+#define PINMAP_D2_UARTAF AF_0
+#define PINMAP_D3_SPIAF AF_1
+#define PINMAP_D4_SPIAF AF_1
+#define PINMAP_D4_UARTAF AF_0
+#define PINMAP_D5_SPIAF AF_1
+#define PINMAP_D5_UARTAF AF_0
+#define PINMAP_D6_SPIAF AF_1
+#define PINMAP_D6_UARTAF AF_0
+#define PINMAP_D8_SPIAF AF_1
+#define PINMAP_D8_UARTAF AF_0
+#define PINMAP_D9_SPIAF AF_1
+#define PINMAP_D9_UARTAF AF_0
+#define PINMAP_F0_TIM TIM14
+#define PINMAP_F0_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_F0_TIMAF AF_2
+#endif
+
+#if defined(STM32G071xx)
+#define PINMAP_A0_ADC LL_ADC_CHANNEL_0
+#define PINMAP_A0_SPIAF AF_0
+#define PINMAP_A0_UARTAF AF_4
+#define PINMAP_A1_ADC LL_ADC_CHANNEL_1
+#define PINMAP_A1_TIM TIM2
+#define PINMAP_A1_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_A1_TIMAF AF_2
+#define PINMAP_A1_SPIAF AF_0
+#define PINMAP_A1_UARTAF AF_4
+#define PINMAP_A2_ADC LL_ADC_CHANNEL_2
+#define PINMAP_A2_TIM TIM2
+#define PINMAP_A2_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_A2_TIMAF AF_2
+#define PINMAP_A2_SPIAF AF_0
+#define PINMAP_A2_UARTAF AF_1
+#define PINMAP_A3_ADC LL_ADC_CHANNEL_3
+#define PINMAP_A3_TIM TIM2
+#define PINMAP_A3_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_A3_TIMAF AF_2
+#define PINMAP_A3_SPIAF AF_0
+#define PINMAP_A3_UARTAF AF_1
+#define PINMAP_A4_ADC LL_ADC_CHANNEL_4
+#define PINMAP_A4_TIM TIM14
+#define PINMAP_A4_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A4_TIMAF AF_4
+#define PINMAP_A4_SPIAF AF_1
+#define PINMAP_A5_ADC LL_ADC_CHANNEL_5
+#define PINMAP_A5_SPIAF AF_0
+#define PINMAP_A5_UARTAF AF_4
+#define PINMAP_A6_ADC LL_ADC_CHANNEL_6
+#define PINMAP_A6_TIM TIM3
+#define PINMAP_A6_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A6_TIMAF AF_1
+#define PINMAP_A6_SPIAF AF_0
+#define PINMAP_A7_ADC LL_ADC_CHANNEL_7
+#define PINMAP_A7_TIM TIM3
+#define PINMAP_A7_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_A7_TIMAF AF_1
+#define PINMAP_A7_SPIAF AF_0
+#define PINMAP_A8_TIM TIM1
+#define PINMAP_A8_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_A8_TIMAF AF_2
+#define PINMAP_A8_SPIAF AF_1
+#define PINMAP_A9_TIM TIM1
+#define PINMAP_A9_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_A9_TIMAF AF_2
+#define PINMAP_A9_SPIAF AF_4
+#define PINMAP_A9_I2CAF AF_6
+#define PINMAP_A9_UARTAF AF_1
+#define PINMAP_A10_TIM TIM1
+#define PINMAP_A10_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_A10_TIMAF AF_2
+#define PINMAP_A10_SPIAF AF_0
+#define PINMAP_A10_I2CAF AF_6
+#define PINMAP_A10_UARTAF AF_1
+#define PINMAP_A11_TIM TIM1
+#define PINMAP_A11_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_A11_TIMAF AF_2
+#define PINMAP_A11_SPIAF AF_0
+#define PINMAP_A11_I2CAF AF_6
+#define PINMAP_A12_SPIAF AF_0
+#define PINMAP_A12_I2CAF AF_6
+#define PINMAP_A12_UARTAF AF_1
+#define PINMAP_A15_SPIAF AF_0
+#define PINMAP_A15_UARTAF AF_1
+#define PINMAP_B0_ADC LL_ADC_CHANNEL_8
+#define PINMAP_B0_TIM TIM3
+#define PINMAP_B0_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_B0_TIMAF AF_1
+#define PINMAP_B0_SPIAF AF_0
+#define PINMAP_B0_UARTAF AF_4
+#define PINMAP_B1_ADC LL_ADC_CHANNEL_9
+#define PINMAP_B1_TIM TIM3
+#define PINMAP_B1_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_B1_TIMAF AF_1
+#define PINMAP_B1_UARTAF AF_4
+#define PINMAP_B2_ADC LL_ADC_CHANNEL_10
+#define PINMAP_B2_SPIAF AF_1
+#define PINMAP_B2_UARTAF AF_4
+#define PINMAP_B3_TIM TIM1
+#define PINMAP_B3_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_B3_TIMAF AF_1
+#define PINMAP_B3_SPIAF AF_0
+#define PINMAP_B3_UARTAF AF_4
+#define PINMAP_B4_TIM TIM3
+#define PINMAP_B4_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B4_TIMAF AF_1
+#define PINMAP_B4_SPIAF AF_0
+#define PINMAP_B5_TIM TIM3
+#define PINMAP_B5_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_B5_TIMAF AF_1
+#define PINMAP_B5_SPIAF AF_0
+#define PINMAP_B6_TIM TIM1
+#define PINMAP_B6_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_B6_TIMAF AF_1
+#define PINMAP_B6_SPIAF AF_4
+#define PINMAP_B6_I2CAF AF_6
+#define PINMAP_B6_UARTAF AF_0
+#define PINMAP_B7_SPIAF AF_1
+#define PINMAP_B7_I2CAF AF_6
+#define PINMAP_B7_UARTAF AF_0
+#define PINMAP_B8_TIM TIM16
+#define PINMAP_B8_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B8_TIMAF AF_2
+#define PINMAP_B8_SPIAF AF_1
+#define PINMAP_B8_I2CAF AF_6
+#define PINMAP_B8_UARTAF AF_4
+#define PINMAP_B9_TIM TIM17
+#define PINMAP_B9_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B9_TIMAF AF_2
+#define PINMAP_B9_SPIAF AF_5
+#define PINMAP_B9_I2CAF AF_6
+#define PINMAP_B9_UARTAF AF_4
+#define PINMAP_B10_ADC LL_ADC_CHANNEL_11
+#define PINMAP_B10_TIM TIM2
+#define PINMAP_B10_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_B10_TIMAF AF_2
+#define PINMAP_B10_SPIAF AF_5
+#define PINMAP_B10_I2CAF AF_6
+#define PINMAP_B10_UARTAF AF_4
+#define PINMAP_B11_ADC LL_ADC_CHANNEL_15
+#define PINMAP_B11_TIM TIM2
+#define PINMAP_B11_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_B11_TIMAF AF_2
+#define PINMAP_B11_SPIAF AF_0
+#define PINMAP_B11_I2CAF AF_6
+#define PINMAP_B11_UARTAF AF_4
+#define PINMAP_B12_ADC LL_ADC_CHANNEL_16
+#define PINMAP_B12_SPIAF AF_0
+#define PINMAP_B13_SPIAF AF_0
+#define PINMAP_B13_I2CAF AF_6
+#define PINMAP_B14_TIM TIM15
+#define PINMAP_B14_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_B14_TIMAF AF_5
+#define PINMAP_B14_SPIAF AF_0
+#define PINMAP_B14_I2CAF AF_6
+#define PINMAP_B14_UARTAF AF_4
+#define PINMAP_B15_TIM TIM15
+#define PINMAP_B15_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_B15_TIMAF AF_5
+#define PINMAP_B15_SPIAF AF_0
+#define PINMAP_C1_TIM TIM15
+#define PINMAP_C1_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C1_TIMAF AF_2
+#define PINMAP_C2_TIM TIM15
+#define PINMAP_C2_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C2_TIMAF AF_2
+#define PINMAP_C2_SPIAF AF_1
+#define PINMAP_C3_SPIAF AF_1
+#define PINMAP_C4_ADC LL_ADC_CHANNEL_17
+#define PINMAP_C4_UARTAF AF_1
+#define PINMAP_C5_ADC LL_ADC_CHANNEL_18
+#define PINMAP_C5_TIM TIM2
+#define PINMAP_C5_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C5_TIMAF AF_2
+#define PINMAP_C5_UARTAF AF_1
+#define PINMAP_C6_TIM TIM3
+#define PINMAP_C6_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C6_TIMAF AF_1
+#define PINMAP_C7_TIM TIM3
+#define PINMAP_C7_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C7_TIMAF AF_1
+#define PINMAP_C8_TIM TIM1
+#define PINMAP_C8_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C8_TIMAF AF_2
+#define PINMAP_C9_TIM TIM1
+#define PINMAP_C9_TIMCH LL_TIM_CHANNEL_CH2
+#define PINMAP_C9_TIMAF AF_2
+#define PINMAP_C10_TIM TIM1
+#define PINMAP_C10_TIMCH LL_TIM_CHANNEL_CH3
+#define PINMAP_C10_TIMAF AF_2
+#define PINMAP_C10_UARTAF AF_0
+#define PINMAP_C11_TIM TIM1
+#define PINMAP_C11_TIMCH LL_TIM_CHANNEL_CH4
+#define PINMAP_C11_TIMAF AF_2
+#define PINMAP_C11_UARTAF AF_0
+#define PINMAP_C12_TIM TIM14
+#define PINMAP_C12_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_C12_TIMAF AF_2
+#define PINMAP_D0_TIM TIM16
+#define PINMAP_D0_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_D0_TIMAF AF_2
+#define PINMAP_D0_SPIAF AF_1
+#define PINMAP_D1_TIM TIM17
+#define PINMAP_D1_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_D1_TIMAF AF_2
+#define PINMAP_D1_SPIAF AF_1
+#define PINMAP_D2_UARTAF AF_0
+#define PINMAP_D3_SPIAF AF_1
+#define PINMAP_D4_SPIAF AF_1
+#define PINMAP_D4_UARTAF AF_0
+#define PINMAP_D5_SPIAF AF_1
+#define PINMAP_D5_UARTAF AF_0
+#define PINMAP_D6_SPIAF AF_1
+#define PINMAP_D6_UARTAF AF_0
+#define PINMAP_D8_SPIAF AF_1
+#define PINMAP_D8_UARTAF AF_0
+#define PINMAP_D9_SPIAF AF_1
+#define PINMAP_D9_UARTAF AF_0
+#define PINMAP_F0_TIM TIM14
+#define PINMAP_F0_TIMCH LL_TIM_CHANNEL_CH1
+#define PINMAP_F0_TIMAF AF_2
+#endif
+
+#endif
@@ -11,9 +11,67 @@
 #ifndef __PWM_H
 #define __PWM_H
 
+#include <stdbool.h>
 #include "pinmap_hal.h"
 #include "stm32g0xx_ll_tim.h"
 
+/** 
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// One pulse trigger sources, ITRx are other timers (see "TIMx internal
+// trigger connection" in the reference manual) configured with tim_triggerOutput()
+#define PULSE_TRIGGER_SOFTWARE 0xFFFFFFFFUL
+#define PULSE_TRIGGER_TI1 LL_TIM_TS_TI1FP1 /*!< CH1 pin of the same timer */
+#define PULSE_TRIGGER_TI2 LL_TIM_TS_TI2FP2 /*!< CH2 pin of the same timer */
+#define PULSE_TRIGGER_ITR0 LL_TIM_TS_ITR0
+#define PULSE_TRIGGER_ITR1 LL_TIM_TS_ITR1
+#define PULSE_TRIGGER_ITR2 LL_TIM_TS_ITR2
+#define PULSE_TRIGGER_ITR3 LL_TIM_TS_ITR3
+
+// One pulse modes
+#define PULSE_MODE_SINGLE 0        /*!< Triggers are ignored while the pulse is running */
+#define PULSE_MODE_RETRIGGERABLE 1 /*!< A trigger restarts the delay and the pulse */
+
+// Trigger pin edges
+#define PULSE_EDGE_RISING 0
+#define PULSE_EDGE_FALLING 1
+
+// Break inputs (TIM1, TIM15, TIM16, TIM17), BRK2 is only available on TIM1
+#define PWM_BREAK1 1
+#define PWM_BREAK2 2
+// Break sources, can be ORed
+#define PWM_BREAK_SRC_PIN LL_TIM_BKIN_SOURCE_BKIN
+#define PWM_BREAK_SRC_COMP1 LL_TIM_BKIN_SOURCE_BKCOMP1
+#define PWM_BREAK_SRC_COMP2 LL_TIM_BKIN_SOURCE_BKCOMP2
+// Break pin polarity
+#define PWM_BREAK_ACTIVE_LOW 0
+#define PWM_BREAK_ACTIVE_HIGH 1
+
+// Commutation step of a channel
+#define PWM_STEP_OFF 0 /*!< Both outputs inactive */
+#define PWM_STEP_PWM 1 /*!< PWM on CHx, complementary on CHxN */
+#define PWM_STEP_LOW 2 /*!< CHx inactive, CHxN active */
+
+/** 
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+/**
+ * @brief PWM channel resolved by pwm_channelInit(), for fast writes.
+ * Initialize it again if the timer period changes.
+ */
+typedef struct
+{
+  TIM_TypeDef *TIMx;
+  volatile uint32_t *ccr; // CCRx register of the channel
+  uint32_t counts;        // ARR + 1, limited to the CCR range
+} pwm_channel_t;
+
 /** 
  ===============================================================================
               ##### Public Functions #####
@@ -26,4 +84,212 @@ void pwm_init500Hz(TIM_TypeDef *TIMx);
 void pwm_pinEnable(pin_t pin);
 void pwm_write(pin_t pin, uint16_t val);
 
+/**
+ * @brief Initialize the PWM timer at any frequency with the highest resolution
+ * 
+ * @param {TIMx} Timer
+ * @param {hz} PWM frequency
+ * @param {min_resolution_bits} Minimum resolution accepted (1 - 16)
+ * @return {uint8_t} Resolution obtained in bits, 0 if it's lower than min_resolution_bits (timer not initialized)
+ */
+uint8_t pwm_initFreq(TIM_TypeDef *TIMx, uint32_t hz, uint8_t min_resolution_bits);
+
+/**
+ * @brief Write the duty cycle of a PWM pin, independent of the timer period
+ * 
+ * @param {pin} PWM pin
+ * @param {duty} Duty cycle, 0 (0%) to 65535 (100%)
+ */
+void pwm_writeDuty(pin_t pin, uint16_t duty);
+
+/** 
+ ===============================================================================
+              ##### Fast Write Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Resolve the timer registers of a PWM pin (pwm_pinEnable first)
+ * 
+ * @param {ch} Channel handle
+ * @param {pin} PWM pin
+ */
+void pwm_channelInit(pwm_channel_t *ch, pin_t pin);
+
+/**
+ * @brief Write the compare value of a channel, without range check
+ * 
+ * @param {ch} Channel handle
+ * @param {val} Compare value, 0 to ch->counts (100%)
+ */
+static inline void pwm_set(const pwm_channel_t *ch, uint32_t val)
+{
+  *ch->ccr = val;
+}
+
+/**
+ * @brief Write the duty cycle of a channel
+ * 
+ * @param {ch} Channel handle
+ * @param {duty} Duty cycle, 0 (0%) to 65535 (100%)
+ */
+static inline void pwm_setDuty(const pwm_channel_t *ch, uint16_t duty)
+{
+  *ch->ccr = (duty == 0xFFFF) ? ch->counts : (((uint32_t)duty * ch->counts) >> 16);
+}
+
+/**
+ * @brief Compare values written between pwm_batchBegin() and pwm_batchEnd()
+ * are applied together at the same update event
+ * 
+ * @param {TIMx} Timer
+ */
+static inline void pwm_batchBegin(TIM_TypeDef *TIMx)
+{
+  TIMx->CR1 |= TIM_CR1_UDIS;
+}
+
+static inline void pwm_batchEnd(TIM_TypeDef *TIMx)
+{
+  TIMx->CR1 &= ~TIM_CR1_UDIS;
+}
+
+/**
+ * @brief Write the 4 compare values of a timer at the same update event.
+ * Values of channels the timer doesn't have are ignored.
+ * 
+ * @param {TIMx} Timer
+ * @param {ccr1} Compare value of CH1
+ * @param {ccr2} Compare value of CH2
+ * @param {ccr3} Compare value of CH3
+ * @param {ccr4} Compare value of CH4
+ */
+void pwm_writeAll(TIM_TypeDef *TIMx, uint16_t ccr1, uint16_t ccr2, uint16_t ccr3, uint16_t ccr4);
+
+/** 
+ ===============================================================================
+              ##### Complementary Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Initialize the PWM timer in center aligned mode (symmetric PWM)
+ * 
+ * @param {TIMx} Timer
+ * @param {hz} PWM frequency
+ * @param {min_resolution_bits} Minimum resolution accepted (1 - 16)
+ * @return {uint8_t} Resolution obtained in bits, 0 if it's lower than min_resolution_bits (timer not initialized)
+ */
+uint8_t pwm_initCenterAligned(TIM_TypeDef *TIMx, uint32_t hz, uint8_t min_resolution_bits);
+
+/**
+ * @brief Set the dead time inserted between CHx and CHxN (TIM1, TIM15, TIM16, TIM17)
+ * 
+ * @param {TIMx} Timer
+ * @param {ns} Dead time in nanoseconds, up to 1008 timer clock cycles
+ * @return {uint32_t} Dead time applied in nanoseconds (rounded up), 0 if the timer clock is unknown
+ */
+uint32_t pwm_setDeadTime(TIM_TypeDef *TIMx, uint32_t ns);
+
+/**
+ * @brief Enable a PWM pin and its complementary output, use pwm_write on pin
+ * 
+ * @param {pin} PWM pin (CHx)
+ * @param {pinN} Complementary pin of the same channel (CHxN)
+ */
+void pwm_pinEnableComplementary(pin_t pin, pin_t pinN);
+
+/**
+ * @brief Enable a break input, the outputs go to their idle (low) state when
+ * it's active, and stay off until pwm_breakResume()
+ * 
+ * @param {TIMx} Timer
+ * @param {PWM_BREAKx} PWM_BREAK1 or PWM_BREAK2
+ * @param {PWM_BREAK_SRC_x} Sources: PWM_BREAK_SRC_PIN, PWM_BREAK_SRC_COMP1, PWM_BREAK_SRC_COMP2 (ORed)
+ * @param {PWM_BREAK_ACTIVE_x} Pin polarity (comparators are active high)
+ * @param {pin} Break pin, used with PWM_BREAK_SRC_PIN
+ */
+void pwm_breakEnable(TIM_TypeDef *TIMx, uint8_t PWM_BREAKx, uint32_t PWM_BREAK_SRC_x, uint8_t PWM_BREAK_ACTIVE_x, pin_t pin);
+
+/**
+ * @brief Enable the outputs again after a break
+ * 
+ * @param {TIMx} Timer
+ * @return {bool} false if the fault is still present
+ */
+bool pwm_breakResume(TIM_TypeDef *TIMx);
+
+/**
+ * @brief Preload the channel states, so all of them change at the same COM
+ * event (6 step commutation)
+ * 
+ * @param {TIMx} Timer
+ * @param {on_trigger} true to generate COM also on the trigger input (TRGI)
+ */
+void pwm_commutationInit(TIM_TypeDef *TIMx, bool on_trigger);
+
+/**
+ * @brief Prepare the next state of a channel
+ * 
+ * @param {TIMx} Timer
+ * @param {channel} LL_TIM_CHANNEL_CH1, LL_TIM_CHANNEL_CH2 or LL_TIM_CHANNEL_CH3
+ * @param {PWM_STEP_x} PWM_STEP_OFF, PWM_STEP_PWM or PWM_STEP_LOW
+ */
+void pwm_commutationStep(TIM_TypeDef *TIMx, uint32_t channel, uint8_t PWM_STEP_x);
+
+/**
+ * @brief Apply the prepared states by software (COM event)
+ * 
+ * @param {TIMx} Timer
+ */
+void pwm_commutate(TIM_TypeDef *TIMx);
+
+/** 
+ ===============================================================================
+              ##### One Pulse Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Configure the timer of a pin to generate a single pulse per trigger.
+ * The output goes high delay_us after the trigger and stays high for width_us,
+ * without CPU intervention. The whole timer is used by the pulse.
+ * External triggers require TIM1, TIM2, TIM3 or TIM15, TIM14/16/17 only
+ * support PULSE_TRIGGER_SOFTWARE. With PULSE_TRIGGER_SOFTWARE a retriggerable
+ * pulse is restarted by pwm_pulseTrigger().
+ * 
+ * @param {pin} Output pin (timer channel)
+ * @param {delay_us} Delay from the trigger, at least 1 timer tick
+ * @param {width_us} Pulse width, delay_us + width_us up to 60 seconds
+ * @param {PULSE_TRIGGER_x} Trigger source
+ * @param {PULSE_MODE_x} PULSE_MODE_SINGLE or PULSE_MODE_RETRIGGERABLE
+ * @return {bool} false if the timer doesn't support the trigger
+ */
+bool pwm_pulseInit(pin_t pin, uint32_t delay_us, uint32_t width_us, uint32_t PULSE_TRIGGER_x, uint8_t PULSE_MODE_x);
+
+/**
+ * @brief Configure a CH1/CH2 pin of the pulse timer as trigger input
+ * (PULSE_TRIGGER_TI1/PULSE_TRIGGER_TI2)
+ * 
+ * @param {pin} Trigger pin
+ * @param {PULSE_EDGE_x} PULSE_EDGE_RISING or PULSE_EDGE_FALLING
+ */
+void pwm_pulseTriggerPin(pin_t pin, uint8_t PULSE_EDGE_x);
+
+/**
+ * @brief Start a pulse by software
+ * 
+ * @param {pin} Output pin given to pwm_pulseInit()
+ * @param {PULSE_MODE_x} Mode given to pwm_pulseInit()
+ */
+void pwm_pulseTrigger(pin_t pin, uint8_t PULSE_MODE_x);
+
+/**
+ * @brief Check if a pulse (or its delay) is running
+ * 
+ * @param {pin} Output pin given to pwm_pulseInit()
+ * @return {bool} true if running
+ */
+bool pwm_pulseIsBusy(pin_t pin);
+
 #endif
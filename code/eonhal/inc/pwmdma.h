@@ -0,0 +1,131 @@
+/**
+  ******************************************************************************
+  * @file    pwmdma.h
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   PWM DMA Burst Library
+  ******************************************************************************
+*/
+
+#ifndef __PWMDMA_H
+#define __PWMDMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pwm.h"
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * A DMA channel writes a new compare value to the PWM channel on every timer
+ * update event, so each PWM period can have its own duty cycle without CPU.
+ *
+ * The DMA channel is selected at compile time with one of:
+ *   USE_PWMDMA_CH1 (default), USE_PWMDMA_CH2 or USE_PWMDMA_CH3
+ * Only one PWM pin can be driven at a time.
+ *
+ * Long sequences are streamed with pwmdma_stream(): the buffer is split in 2
+ * halves, one is refilled by the fill function while the other is sent.
+ *
+ * WS2812/SK6812 LEDs:
+ *   pwmdma_ws2812Init(PB4);
+ *   pwmdma_ws2812Write(colors, 60, 3); // 60 leds, GRB bytes per led
+ */
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// LEDs encoded in each half of the WS2812 buffer, each half also gives the
+// low time (reset) after the last LED: 4 leds * 24 bits * 1.25 us = 120 us
+#ifndef PWMDMA_LEDS_PER_HALF
+#define PWMDMA_LEDS_PER_HALF 4
+#endif
+
+/**
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Fill function of pwmdma_stream()
+ *
+ * @param {dst} Compare values to be written
+ * @param {count} Number of compare values of dst
+ * @param {ctx} Argument given to pwmdma_stream()
+ * @return {uint16_t} Compare values written, less than count when the stream ends
+ */
+typedef uint16_t (*pwmdmaFill_t)(uint16_t *dst, uint16_t count, void *ctx);
+
+/**
+ ===============================================================================
+              ##### Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Connect the DMA channel to a PWM pin, the timer must be initialized
+ * (pwm_init...) and the pin enabled (pwm_pinEnable) first.
+ *
+ * @param {pin} PWM pin
+ * @return {bool} false if the timer has no DMA request (TIM14)
+ */
+bool pwmdma_init(pin_t pin);
+
+/**
+ * @brief Send a sequence of compare values, one per PWM period
+ *
+ * @param {values} Compare values, must be kept in memory while it's sent
+ * @param {length} Number of values
+ * @param {repeat} true to repeat the sequence until pwmdma_stop()
+ */
+void pwmdma_write(const uint16_t *values, uint16_t length, bool repeat);
+
+/**
+ * @brief Send a sequence generated by a fill function, using a fixed buffer.
+ * The output ends low after the last value and a full half buffer of zeros.
+ *
+ * @param {buffer} Work buffer, must be kept in memory while it's sent
+ * @param {length} Buffer length (even)
+ * @param {fill} Function called from the DMA interrupt to fill each half
+ * @param {ctx} Argument passed to the fill function
+ */
+void pwmdma_stream(uint16_t *buffer, uint16_t length, pwmdmaFill_t fill, void *ctx);
+
+/**
+ * @brief Stop the sequence, the output is left low
+ */
+void pwmdma_stop(void);
+
+/**
+ * @brief Check if a sequence is being sent
+ *
+ * @return {bool} true if busy
+ */
+bool pwmdma_isBusy(void);
+
+/**
+ * @brief Initialize the timer of a pin at 800 KHz for WS2812/SK6812 LEDs
+ *
+ * @param {pin} PWM pin connected to DIN
+ * @return {bool} false if the timer has no DMA request (TIM14)
+ */
+bool pwmdma_ws2812Init(pin_t pin);
+
+/**
+ * @brief Send colors to the LED strip, it returns immediately
+ *
+ * @param {colors} Color bytes in strip order (GRB or GRBW), kept in memory while busy
+ * @param {leds} Number of leds
+ * @param {bytes_per_led} 3 (RGB) or 4 (RGBW)
+ * @return {bool} false if bytes_per_led isn't 1 to 4
+ */
+bool pwmdma_ws2812Write(const uint8_t *colors, uint16_t leds, uint8_t bytes_per_led);
+
+#endif
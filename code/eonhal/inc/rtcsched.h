@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+  * @file    rtcsched.h
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   RTC Job Scheduler Library
+  ******************************************************************************
+*/
+
+#ifndef __RTCSCHED_H
+#define __RTCSCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Any number of jobs share the RTC Alarm A. The jobs are kept sorted by their
+ * next run time and the alarm is always programmed for the first one, so the
+ * device can sleep in Stop mode until the next job. The callbacks are called
+ * from the RTC interrupt. The RTC must be initialized and set first.
+ *
+ * The module uses __Handler_RTC_ALARMA(), so IRQ_RTC_ALARMA() and
+ * rtc_setAlarmA...() can't be used with it. The low power functions use
+ * Alarm B and keep working.
+ *
+ *   static rtcjob_t report, calibrate;
+ *   rtccron_t at3 = {RTCCRON_MINUTE(0), RTCCRON_HOUR(3), RTCCRON_ALL_DAYS,
+ *                    RTCCRON_ALL_MONTHS, RTCCRON_ALL_WEEKDAYS};
+ *   rtcsched_every(&report, 15 * 60, sendReport, NULL);
+ *   rtcsched_cron(&calibrate, &at3, calibrateSensor, NULL);
+ *
+ * Times are unix times of the RTC. The Alarm A matches the time of the day
+ * only, so a job more than a day away wakes the device once a day to
+ * reprogram it.
+ *
+ * rtcjob_t handles must be zero initialized (global, static or = {0}).
+ */
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// Cron fields
+#define RTCCRON_MINUTE(__M__) (1ULL << (__M__))		 /*!< 0 - 59 */
+#define RTCCRON_HOUR(__H__) (1UL << (__H__))			 /*!< 0 - 23 */
+#define RTCCRON_DAY(__D__) (1UL << (__D__))				 /*!< 1 - 31 */
+#define RTCCRON_MONTH(__M__) ((uint16_t)(1U << (__M__))) /*!< 1 - 12 */
+#define RTCCRON_WEEKDAY(__W__) ((uint8_t)(1U << (__W__)))	 /*!< RTC_MONDAY (1) - RTC_SUNDAY (7) */
+#define RTCCRON_ALL_MINUTES 0x0FFFFFFFFFFFFFFFULL
+#define RTCCRON_ALL_HOURS 0x00FFFFFFUL
+#define RTCCRON_ALL_DAYS 0xFFFFFFFEUL
+#define RTCCRON_ALL_MONTHS ((uint16_t)0x1FFE)
+#define RTCCRON_ALL_WEEKDAYS ((uint8_t)0xFE)
+
+/**
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+typedef void (*rtcjobCallback_t)(void *ctx);
+
+/**
+ * @brief Calendar recurrence, like a cron line. The job runs at the second 0
+ * of the minutes that match all the fields (day and weekday must both match).
+ */
+typedef struct
+{
+  uint64_t minutes;
+  uint32_t hours;
+  uint32_t days;
+  uint16_t months;
+  uint8_t weekdays;
+} rtccron_t;
+
+/**
+ * @brief Job handle, must be kept in memory while it's scheduled.
+ * Its fields are private.
+ */
+typedef struct rtcjob_s
+{
+  struct rtcjob_s *next;
+  uint32_t time;   // next run, unix
+  uint32_t period; // seconds, 0 if it isn't periodic
+  rtccron_t cron;
+  rtcjobCallback_t callback;
+  void *ctx;
+  uint8_t type;
+} rtcjob_t;
+
+/**
+ ===============================================================================
+              ##### Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Run a job once at a given time
+ *
+ * @param {job} Job handle
+ * @param {unix} Time, a past time runs the job in the next second
+ * @param {callback} Function to be called
+ * @param {ctx} Argument passed to the callback
+ */
+void rtcsched_at(rtcjob_t *job, uint32_t unix, rtcjobCallback_t callback, void *ctx);
+
+/**
+ * @brief Run a job periodically. Periods missed (while the RTC was changed)
+ * are run once.
+ *
+ * @param {job} Job handle
+ * @param {seconds} Period, the first run is a period from now
+ * @param {callback} Function to be called
+ * @param {ctx} Argument passed to the callback
+ */
+void rtcsched_every(rtcjob_t *job, uint32_t seconds, rtcjobCallback_t callback, void *ctx);
+
+/**
+ * @brief Run a job on a calendar recurrence
+ *
+ * @param {job} Job handle
+ * @param {cron} Recurrence, it's copied
+ * @param {callback} Function to be called
+ * @param {ctx} Argument passed to the callback
+ * @return {bool} false if the recurrence never matches
+ */
+bool rtcsched_cron(rtcjob_t *job, const rtccron_t *cron, rtcjobCallback_t callback, void *ctx);
+
+/**
+ * @brief Remove a job. Safe to call from a callback.
+ *
+ * @param {job} Job handle
+ */
+void rtcsched_cancel(rtcjob_t *job);
+
+/**
+ * @brief Check if a job is scheduled
+ *
+ * @param {job} Job handle
+ * @return {bool} true if scheduled
+ */
+bool rtcsched_isActive(rtcjob_t *job);
+
+/**
+ * @brief Time of the first job
+ *
+ * @return {uint32_t} Unix time, 0 if there are no jobs
+ */
+uint32_t rtcsched_next(void);
+
+/**
+ * @brief Recalculate the calendar jobs and the alarm, call it after setting
+ * the RTC time
+ */
+void rtcsched_reschedule(void);
+
+/**
+ * @brief Get the next time a recurrence matches
+ *
+ * @param {cron} Recurrence
+ * @param {unix} Start time, the result is after it
+ * @return {uint32_t} Unix time, 0 if it doesn't match (like February 30)
+ */
+uint32_t rtcsched_cronNext(const rtccron_t *cron, uint32_t unix);
+
+#endif
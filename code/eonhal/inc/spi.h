@@ -56,5 +56,6 @@ uint8_t spiSlave_read8(SPI_TypeDef *SPIx);
 uint16_t spiSlave_read16(SPI_TypeDef *SPIx);
 void spiSlave_write8(SPI_TypeDef *SPIx, uint8_t val);
 void spiSlave_write16(SPI_TypeDef *SPIx, uint16_t val);
+void SPISlave_off(SPI_TypeDef *SPIx); // Stop modes can be used again
 
 #endif
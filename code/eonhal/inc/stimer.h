@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file    stimer.h
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Software Timers Library
+  ******************************************************************************
+*/
+
+#ifndef __STIMER_H
+#define __STIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ ===============================================================================
+              ##### Usage #####
+ ===============================================================================
+ *
+ * Any number of software timers share a single hardware timer. The hardware
+ * compare is always programmed for the next timer deadline, so the CPU is
+ * not interrupted on every millisecond tick.
+ *
+ * The hardware timer is selected at compile time with one of:
+ *   USE_STIMER_TIM14 (default), USE_STIMER_TIM3, USE_STIMER_TIM15,
+ *   USE_STIMER_TIM16 or USE_STIMER_TIM17
+ * The selected timer can't be used with IRQ_TIMx() or as PWM at the same time.
+ * With USE_TICKLESS the service runs on the LPTIM timebase of millis() instead,
+ * and no hardware timer is used.
+ *
+ * Timers are kept in a hierarchical timer wheel (4 levels of 32 slots), so
+ * starting and stopping a timer is O(1) no matter how many are running.
+ *
+ * stimer_t handles must be zero initialized (global, static or = {0}).
+ */
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// Timer modes
+#define STIMER_ONESHOT ((uint8_t)0x00)  /*!< Callback executed once */
+#define STIMER_PERIODIC ((uint8_t)0x01) /*!< Callback executed every period */
+#define STIMER_DEFERRED ((uint8_t)0x02) /*!< Callback executed by stimer_run() instead of the ISR */
+
+/**
+ ===============================================================================
+              ##### Types #####
+ ===============================================================================
+ */
+
+typedef void (*stimerCallback_t)(void *ctx);
+
+/**
+ * @brief Software timer handle, must be kept in memory while it's running.
+ * Its fields are private.
+ */
+typedef struct stimer_s
+{
+  struct stimer_s *next;
+  struct stimer_s *prev;
+  uint32_t expires;
+  uint32_t period;
+  stimerCallback_t callback;
+  void *ctx;
+  struct stimer_s *ready;
+  uint8_t mode;
+  uint8_t list;  // wheel list where the timer is linked, 0 if it isn't
+  uint8_t flags; // deferred state
+} stimer_t;
+
+/**
+ ===============================================================================
+              ##### Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Initialize the software timers service.
+ * Call it again after changing the system clock.
+ */
+void stimer_init(void);
+
+/**
+ * @brief Start (or restart) a software timer
+ *
+ * @param {t} Timer handle
+ * @param {ms} Milliseconds until the first expiration (and period if periodic)
+ * @param {mode} STIMER_ONESHOT or STIMER_PERIODIC, optionally ORed with STIMER_DEFERRED
+ * @param {callback} Function to be called when the timer expires
+ * @param {ctx} Argument passed to the callback
+ */
+void stimer_start(stimer_t *t, uint32_t ms, uint8_t mode, stimerCallback_t callback, void *ctx);
+
+/**
+ * @brief Stop a software timer. Safe to call from the callback or an ISR.
+ *
+ * @param {t} Timer handle
+ */
+void stimer_stop(stimer_t *t);
+
+/**
+ * @brief Check if the timer is running or waiting to be run by stimer_run()
+ *
+ * @param {t} Timer handle
+ * @return {bool} true if active
+ */
+bool stimer_isActive(stimer_t *t);
+
+/**
+ * @brief Execute the callbacks of the expired STIMER_DEFERRED timers.
+ * Call it from the main loop. Periods missed before it's called are executed once.
+ *
+ * @return {uint16_t} Number of callbacks executed
+ */
+uint16_t stimer_run(void);
+
+/**
+ * @brief Get the timebase of the service
+ *
+ * @return {uint32_t} Milliseconds
+ */
+uint32_t stimer_now(void);
+
+#endif
@@ -177,6 +177,7 @@ typedef struct
 /* Timer Clocks */
 uint8_t tim_clkEnableAndGetIRQn(TIM_TypeDef *TIMx);
 uint32_t tim_getSrcClk(TIM_TypeDef *TIMx);
+uint32_t tim_powerUser(TIM_TypeDef *TIMx); // POWER_USER_TIMx of the power manager
 
 /* Period and Prescalers from desired frequency, return timer frequency clock */
 uint32_t tim_getMinPrescalerAndMaxPeriod(timebase_t *parameter, TIM_TypeDef *TIMx, uint32_t desired_frecuency);
@@ -184,5 +185,10 @@ uint32_t tim_getMinPrescalerAndMaxPeriod(timebase_t *parameter, TIM_TypeDef *TIM
 /* Funciones Timer Interrupt */
 void tim_interrupt(TIM_TypeDef *TIMx, uint32_t prescaler, uint32_t period);
 void tim_interruptMs(TIM_TypeDef *TIMx, uint32_t ms);
+/* Stop the timer (interrupt or PWM), Stop modes can be used again */
+void tim_off(TIM_TypeDef *TIMx);
+
+/* Trigger output (TRGO) for other timers, TIM_TRGO_x: LL_TIM_TRGO_UPDATE, LL_TIM_TRGO_OC1REF... */
+void tim_triggerOutput(TIM_TypeDef *TIMx, uint32_t TIM_TRGO_x);
 
 #endif
@@ -36,7 +36,10 @@ typedef struct
  ===============================================================================
  */
 
+// Calendar conversions, constant time. The year is in xx format from 2000,
+// unix time is valid up to 2106.
 void unix2time(uint32_t unix, LocalTime_t *t);
 uint32_t time2unix(uint8_t day, uint8_t month, uint8_t year, uint8_t hours, uint8_t minutes, uint8_t seconds);
+uint32_t date2days(uint16_t year, uint8_t month, uint8_t day); // days since 1970-01-01, year >= 1970
 
 #endif
@@ -9,8 +9,13 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "System.h"
+#if defined(USE_TICKLESS)
+#include "stm32g0xx_ll_lptim.h"
+#endif
 
 /* Millis --------------------------------------------------------------------*/
+#if !defined(USE_TICKLESS)
+
 volatile uint32_t __ticks_millis;
 void SysTick_Handler(void)
 {
@@ -21,6 +26,315 @@ uint32_t millis(void)
 {
   return __ticks_millis;
 }
+
+uint32_t micros(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t ms, count, load;
+
+  __disable_irq();
+  ms = __ticks_millis;
+  load = SysTick->LOAD;
+  count = load - SysTick->VAL;
+  // Reloaded but not counted yet (called with interrupts disabled or from a higher priority ISR)
+  if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0 && count < (load / 2))
+    ms++;
+  __set_PRIMASK(primask);
+
+  return (ms * 1000) + ((count * 1000) / (load + 1));
+}
+
+void system_tickResume(void)
+{
+  LL_SYSTICK_EnableIT();
+}
+
+void system_tickSuspend(void)
+{
+  LL_SYSTICK_DisableIT();
+}
+
+#else
+
+/* Tickless timebase ---------------------------------------------------------*/
+#if !defined(LPTIM1)
+#error "USE_TICKLESS requires a device with LPTIM (STM32G071/G081)"
+#endif
+
+#if defined(USE_TICKLESS_LPTIM2)
+#define TICKLESS_LPTIM LPTIM2
+#define TICKLESS_LPTIM_PERIPH LL_APB1_GRP1_PERIPH_LPTIM2
+#define TICKLESS_LPTIM_CLKSOURCE_LSE LL_RCC_LPTIM2_CLKSOURCE_LSE
+#define TICKLESS_LPTIM_CLKSOURCE_LSI LL_RCC_LPTIM2_CLKSOURCE_LSI
+#define TICKLESS_EXTI_LINE LL_EXTI_LINE_30
+#define TICKLESS_IRQn TIM7_LPTIM2_IRQn
+#define TICKLESS_IRQHandler TIM7_LPTIM2_IRQHandler
+#else
+#define TICKLESS_LPTIM LPTIM1
+#define TICKLESS_LPTIM_PERIPH LL_APB1_GRP1_PERIPH_LPTIM1
+#define TICKLESS_LPTIM_CLKSOURCE_LSE LL_RCC_LPTIM1_CLKSOURCE_LSE
+#define TICKLESS_LPTIM_CLKSOURCE_LSI LL_RCC_LPTIM1_CLKSOURCE_LSI
+#define TICKLESS_EXTI_LINE LL_EXTI_LINE_29
+#define TICKLESS_IRQn TIM6_DAC_LPTIM1_IRQn
+#define TICKLESS_IRQHandler TIM6_DAC_LPTIM1_IRQHandler
+#endif
+
+#ifndef TICKLESS_PRIORITY
+#define TICKLESS_PRIORITY 0x00
+#endif
+
+// The LPTIM counts the 32 KHz clock divided by 32:
+// LSE: 1024 ticks per second, a full counter period is exactly 64000 ms
+// LSI: 1000 ticks per second (TICKLESS_USE_LSI, less accurate)
+#if defined(TICKLESS_USE_LSI)
+#define TICKLESS_PERIOD_MS 65536UL
+#define TICKLESS_TICKS2MS(__T__) ((uint32_t)(__T__))
+#define TICKLESS_MS2TICKS(__MS__) ((uint32_t)(__MS__))
+#else
+#define TICKLESS_PERIOD_MS 64000UL
+#define TICKLESS_TICKS2MS(__T__) (((uint32_t)(__T__)*125UL) >> 7)
+#define TICKLESS_MS2TICKS(__MS__) ((((uint32_t)(__MS__)*128UL) + 124UL) / 125UL)
+#endif
+
+// A compare is never programmed farther than half a counter period, so the
+// counter is always read before it overflows twice
+#define TICKLESS_MAX_TICKS 0x8000UL
+#define TICKLESS_MAX_MS TICKLESS_TICKS2MS(TICKLESS_MAX_TICKS)
+
+static bool _tl_started = false;
+static uint32_t _tl_epoch;   // millis when the counter was 0
+static uint16_t _tl_lastCnt; // last counter value read
+static bool _tl_cmpBusy;     // compare register write in progress
+static uint32_t _tl_deadline[TICKLESS_DEADLINES];
+static uint8_t _tl_active; // one bit per programmed deadline
+
+void __Handler_TICKLESS_STIMER(void) __attribute__((weak));
+
+// These functions must be called with interrupts disabled
+
+static uint16_t _tl_counter(void)
+{
+  uint16_t cnt;
+  // The counter runs asynchronously, it's valid when 2 reads match
+  do
+  {
+    cnt = (uint16_t)LL_LPTIM_GetCounter(TICKLESS_LPTIM);
+  } while (cnt != (uint16_t)LL_LPTIM_GetCounter(TICKLESS_LPTIM));
+  return cnt;
+}
+
+static uint32_t _tl_read(uint16_t *cnt)
+{
+  *cnt = _tl_counter();
+  if (*cnt < _tl_lastCnt)
+    _tl_epoch += TICKLESS_PERIOD_MS;
+  _tl_lastCnt = *cnt;
+  return _tl_epoch + TICKLESS_TICKS2MS(*cnt);
+}
+
+static void _tl_setCompare(uint16_t cmp)
+{
+  // A new value can only be written when the previous one was loaded
+  if (_tl_cmpBusy)
+  {
+    while (LL_LPTIM_IsActiveFlag_CMPOK(TICKLESS_LPTIM) == 0)
+      ;
+  }
+  LL_LPTIM_ClearFlag_CMPOK(TICKLESS_LPTIM);
+  LL_LPTIM_SetCompare(TICKLESS_LPTIM, cmp);
+  _tl_cmpBusy = true;
+}
+
+static void _tl_program(void)
+{
+  uint8_t i;
+  uint16_t cnt;
+  uint32_t delta, ticks;
+  uint32_t now = _tl_read(&cnt);
+  uint32_t ms = TICKLESS_MAX_MS;
+
+  for (i = 0; i < TICKLESS_DEADLINES; i++)
+  {
+    if ((_tl_active & (1U << i)) == 0)
+      continue;
+    delta = _tl_deadline[i] - now;
+    if ((int32_t)delta <= 0)
+    {
+      NVIC_SetPendingIRQ(TICKLESS_IRQn);
+      return;
+    }
+    if (delta < ms)
+      ms = delta;
+  }
+
+  ticks = TICKLESS_MS2TICKS(ms);
+  if (ticks > TICKLESS_MAX_TICKS)
+    ticks = TICKLESS_MAX_TICKS;
+
+  // The compare must be lower than the autoreload (0xFFFF), one tick earlier is
+  // handled by the interrupt as a not expired deadline
+  if ((uint16_t)(cnt + ticks) == 0xFFFF)
+    _tl_setCompare(0xFFFE);
+  else
+    _tl_setCompare((uint16_t)(cnt + ticks));
+
+  // The counter could have reached the compare value while it was written
+  if (ticks <= 2)
+  {
+    while (LL_LPTIM_IsActiveFlag_CMPOK(TICKLESS_LPTIM) == 0)
+      ;
+    if ((uint16_t)(_tl_counter() - cnt) >= ticks)
+      NVIC_SetPendingIRQ(TICKLESS_IRQn);
+  }
+}
+
+static void _tl_init(void)
+{
+  LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
+#if defined(TICKLESS_USE_LSI)
+  LL_RCC_LSI_Enable();
+  while (LL_RCC_LSI_IsReady() != 1)
+  {
+  };
+  LL_RCC_SetLPTIMClockSource(TICKLESS_LPTIM_CLKSOURCE_LSI);
+#else
+  LL_PWR_EnableBkUpAccess();
+  if (LL_RCC_LSE_IsReady() != 1)
+  {
+    LL_RCC_LSE_Enable();
+    while (LL_RCC_LSE_IsReady() != 1)
+    {
+    };
+  }
+  LL_RCC_SetLPTIMClockSource(TICKLESS_LPTIM_CLKSOURCE_LSE);
+#endif
+  LL_APB1_GRP1_EnableClock(TICKLESS_LPTIM_PERIPH);
+
+  // IER and CFGR can only be written while the LPTIM is disabled
+  LL_LPTIM_Disable(TICKLESS_LPTIM);
+  LL_LPTIM_SetPrescaler(TICKLESS_LPTIM, LL_LPTIM_PRESCALER_DIV32);
+  LL_LPTIM_EnableIT_CMPM(TICKLESS_LPTIM);
+  LL_LPTIM_Enable(TICKLESS_LPTIM);
+
+  LL_LPTIM_ClearFlag_ARROK(TICKLESS_LPTIM);
+  LL_LPTIM_SetAutoReload(TICKLESS_LPTIM, 0xFFFF);
+  while (LL_LPTIM_IsActiveFlag_ARROK(TICKLESS_LPTIM) == 0)
+    ;
+  LL_LPTIM_ClearFlag_CMPOK(TICKLESS_LPTIM);
+  LL_LPTIM_SetCompare(TICKLESS_LPTIM, TICKLESS_MAX_TICKS);
+  while (LL_LPTIM_IsActiveFlag_CMPOK(TICKLESS_LPTIM) == 0)
+    ;
+  _tl_cmpBusy = false;
+  LL_LPTIM_StartCounter(TICKLESS_LPTIM, LL_LPTIM_OPERATING_MODE_CONTINUOUS);
+
+  // The LPTIM event wakes up the core from Stop mode through its EXTI line
+  LL_EXTI_EnableIT_0_31(TICKLESS_EXTI_LINE);
+  NVIC_SetPriority(TICKLESS_IRQn, TICKLESS_PRIORITY);
+  NVIC_EnableIRQ(TICKLESS_IRQn);
+  _tl_started = true;
+}
+
+void TICKLESS_IRQHandler(void)
+{
+  uint8_t i, expired = 0;
+  uint16_t cnt;
+  uint32_t now;
+
+  __disable_irq();
+  if (LL_LPTIM_IsActiveFlag_CMPM(TICKLESS_LPTIM))
+    LL_LPTIM_ClearFLAG_CMPM(TICKLESS_LPTIM);
+  now = _tl_read(&cnt);
+  for (i = 0; i < TICKLESS_DEADLINES; i++)
+  {
+    if ((_tl_active & (1U << i)) && (int32_t)(_tl_deadline[i] - now) <= 0)
+    {
+      _tl_active &= ~(1U << i);
+      expired |= (1U << i);
+    }
+  }
+  _tl_program();
+  __enable_irq();
+
+  // TICKLESS_DEADLINE_DELAY just wakes up system_delay()
+  if (expired & (1U << TICKLESS_DEADLINE_STIMER))
+    __Handler_TICKLESS_STIMER();
+}
+
+uint32_t millis(void)
+{
+  uint16_t cnt;
+  uint32_t now;
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (!_tl_started)
+    _tl_init(); // first use before the clock functions
+  now = _tl_read(&cnt);
+  __set_PRIMASK(primask);
+  return now;
+}
+
+void system_tickResume(void)
+{
+  // SysTick keeps counting (LL_mDelay), but it never interrupts
+  LL_SYSTICK_DisableIT();
+  if (!_tl_started)
+    _tl_init();
+}
+
+void system_tickSuspend(void)
+{
+  // The LPTIM keeps running in Sleep and Stop modes
+}
+
+void tickless_setDeadline(uint8_t TICKLESS_DEADLINE_x, uint32_t millis_time)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  if (!_tl_started)
+    _tl_init();
+  _tl_deadline[TICKLESS_DEADLINE_x] = millis_time;
+  _tl_active |= (1U << TICKLESS_DEADLINE_x);
+  _tl_program();
+  __set_PRIMASK(primask);
+}
+
+void tickless_clearDeadline(uint8_t TICKLESS_DEADLINE_x)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  // The compare is left as it is, an earlier interrupt is harmless
+  __disable_irq();
+  _tl_active &= ~(1U << TICKLESS_DEADLINE_x);
+  __set_PRIMASK(primask);
+}
+
+bool tickless_serviceWakeup(void)
+{
+  uint32_t pending = NVIC->ISPR[0] & NVIC->ISER[0];
+
+  if (pending != (1UL << TICKLESS_IRQn))
+    return false;
+  // Run the LPTIM interrupt
+  __enable_irq();
+  __disable_irq();
+  return true;
+}
+
+void system_delay(uint32_t milliseconds)
+{
+  uint32_t start = millis();
+
+  tickless_setDeadline(TICKLESS_DEADLINE_DELAY, start + milliseconds);
+  while ((millis() - start) < milliseconds)
+  {
+    __WFI();
+  }
+  tickless_clearDeadline(TICKLESS_DEADLINE_DELAY);
+}
+
+#endif
 /* ---------------------------------------------------------------------------*/
 
 /* System Clock Functions ----------------------------------------------------*/
@@ -73,7 +387,7 @@ void CLOCK_HSI_64MHZ(void)
   /* SysTick_IRQn interrupt configuration */
   NVIC_SetPriority(SysTick_IRQn, 0);
 
-  LL_SYSTICK_EnableIT(); // added to enable Systick Interrupt for millis()
+  system_tickResume(); // millis() timebase
 }
 
 void CLOCK_HSI_32MHZ(void)
@@ -124,7 +438,7 @@ void CLOCK_HSI_32MHZ(void)
   /* SysTick_IRQn interrupt configuration */
   NVIC_SetPriority(SysTick_IRQn, 0);
 
-  LL_SYSTICK_EnableIT(); // added to enable Systick Interrupt for millis()
+  system_tickResume(); // millis() timebase
 }
 
 void CLOCK_HSI_16MHZ(void)
@@ -168,7 +482,7 @@ void CLOCK_HSI_16MHZ(void)
   /* SysTick_IRQn interrupt configuration */
   NVIC_SetPriority(SysTick_IRQn, 0);
 
-  LL_SYSTICK_EnableIT(); // added to enable Systick Interrupt for millis()
+  system_tickResume(); // millis() timebase
 }
 
 void CLOCK_HSI_8MHZ(void)
@@ -213,7 +527,7 @@ void CLOCK_HSI_8MHZ(void)
   /* SysTick_IRQn interrupt configuration */
   NVIC_SetPriority(SysTick_IRQn, 0);
 
-  LL_SYSTICK_EnableIT(); // added to enable Systick Interrupt for millis()
+  system_tickResume(); // millis() timebase
 }
 
 void CLOCK_HSI_4MHZ(void)
@@ -258,7 +572,7 @@ void CLOCK_HSI_4MHZ(void)
   /* SysTick_IRQn interrupt configuration */
   NVIC_SetPriority(SysTick_IRQn, 0);
 
-  LL_SYSTICK_EnableIT(); // added to enable Systick Interrupt for millis()
+  system_tickResume(); // millis() timebase
 }
 
 void CLOCK_HSI_2MHZ(void)
@@ -303,5 +617,5 @@ void CLOCK_HSI_2MHZ(void)
   /* SysTick_IRQn interrupt configuration */
   NVIC_SetPriority(SysTick_IRQn, 0);
 
-  LL_SYSTICK_EnableIT(); // added to enable Systick Interrupt for millis()
+  system_tickResume(); // millis() timebase
 }
\ No newline at end of file
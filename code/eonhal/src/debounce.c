@@ -0,0 +1,213 @@
+/**
+  ******************************************************************************
+  * @file    debounce.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Input Debouncing Functions
+  ******************************************************************************
+*/
+
+#include <stddef.h>
+#include "debounce.h"
+#include "gpio.h"
+#include "stimer.h"
+#include "eon_math.h"
+#include "pinmap_impl.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+#define DEBOUNCE_LONG_SAMPLES (DEBOUNCE_LONG_MS / DEBOUNCE_PERIOD_MS)
+
+typedef struct
+{
+	GPIO_TypeDef *GPIOx;
+	uint16_t mask;   // debounced pins
+	uint16_t invert; // active low pins
+	uint16_t state;  // debounced state, 1 = pressed
+	uint16_t cnt0;   // vertical counter, bit 0
+	uint16_t cnt1;   // vertical counter, bit 1
+	uint16_t longp;  // pressed pins already reported as long press
+	pin_t pin[16];
+	uint16_t hold[16]; // samples pressed
+} debounce_port_t;
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static debounce_port_t _ports[DEBOUNCE_MAX_PORTS];
+static uint8_t _nports;
+static debounceCallback_t _callback;
+static void *_ctx;
+static stimer_t _timer;
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+static debounce_port_t *_port(GPIO_TypeDef *GPIOx)
+{
+	uint8_t i;
+
+	for (i = 0; i < _nports; i++)
+	{
+		if (_ports[i].GPIOx == GPIOx)
+			return &_ports[i];
+	}
+	return NULL;
+}
+
+static void _events(debounce_port_t *p, uint16_t bits, uint8_t event)
+{
+	uint8_t n;
+
+	while (bits != 0)
+	{
+		n = lowestBitSet(bits);
+		bits &= bits - 1;
+		if (_callback != NULL)
+			_callback(p->pin[n], event, _ctx);
+	}
+}
+
+static void _scanPort(debounce_port_t *p)
+{
+	uint16_t sample = (uint16_t)((p->GPIOx->IDR ^ p->invert) & p->mask);
+	uint16_t delta = sample ^ p->state;
+	uint16_t changed, pressed, holding;
+	uint8_t n;
+
+	// 2 bit counter per pin, counts the samples different from the state
+	// and is cleared by an equal one. The state flips on the 4th sample.
+	p->cnt1 = (p->cnt1 ^ p->cnt0) & delta;
+	p->cnt0 = ~p->cnt0 & delta;
+	changed = delta & ~(p->cnt0 | p->cnt1);
+	p->state ^= changed;
+
+	if (changed == 0 && (p->state & ~p->longp) == 0)
+		return;
+
+	pressed = changed & p->state;
+	p->longp &= p->state;
+	_events(p, pressed, DEBOUNCE_PRESS);
+	_events(p, changed & ~p->state, DEBOUNCE_RELEASE);
+
+	// Only the pins pressed and not reported yet are counted
+	holding = p->state & ~p->longp & ~pressed;
+	while (holding != 0)
+	{
+		n = lowestBitSet(holding);
+		holding &= holding - 1;
+		if (++p->hold[n] >= DEBOUNCE_LONG_SAMPLES)
+		{
+			p->longp |= (1U << n);
+			_events(p, 1U << n, DEBOUNCE_LONG_PRESS);
+		}
+	}
+	while (pressed != 0)
+	{
+		n = lowestBitSet(pressed);
+		pressed &= pressed - 1;
+		p->hold[n] = 0;
+	}
+}
+
+static void _scan(void *ctx)
+{
+	uint8_t i;
+
+	(void)ctx;
+	for (i = 0; i < _nports; i++)
+		_scanPort(&_ports[i]);
+}
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+void debounce_init(debounceCallback_t callback, void *ctx)
+{
+	_callback = callback;
+	_ctx = ctx;
+	stimer_init();
+	stimer_start(&_timer, DEBOUNCE_PERIOD_MS, STIMER_PERIODIC, _scan, NULL);
+}
+
+bool debounce_add(pin_t pin, pull_t pull, uint8_t active)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	debounce_port_t *p = _port(pin_map[pin].GPIOx);
+	uint16_t bit = pin_map[pin].pin;
+	uint8_t n = lowestBitSet(bit);
+	uint32_t primask;
+
+	if (p == NULL)
+	{
+		if (_nports == DEBOUNCE_MAX_PORTS)
+			return false;
+		p = &_ports[_nports];
+		p->GPIOx = pin_map[pin].GPIOx;
+		p->mask = 0;
+	}
+	gpio_mode(pin, INPUT, pull, SPEED_LOW);
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	p->pin[n] = pin;
+	p->hold[n] = 0;
+	if (active == LOW)
+		p->invert |= bit;
+	else
+		p->invert &= ~bit;
+	// Starts in the current state, so there's no event at startup
+	if ((p->GPIOx->IDR ^ p->invert) & bit)
+		p->state |= bit;
+	else
+		p->state &= ~bit;
+	p->cnt0 &= ~bit;
+	p->cnt1 &= ~bit;
+	p->longp |= bit & p->state;
+	p->mask |= bit;
+	if (p == &_ports[_nports])
+		_nports++;
+	__set_PRIMASK(primask);
+	return true;
+}
+
+void debounce_remove(pin_t pin)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	debounce_port_t *p = _port(pin_map[pin].GPIOx);
+	uint16_t bit = pin_map[pin].pin;
+	uint32_t primask;
+
+	if (p == NULL)
+		return;
+	primask = __get_PRIMASK();
+	__disable_irq();
+	p->mask &= ~bit;
+	p->state &= ~bit;
+	p->cnt0 &= ~bit;
+	p->cnt1 &= ~bit;
+	p->longp &= ~bit;
+	__set_PRIMASK(primask);
+}
+
+bool debounce_isPressed(pin_t pin)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	debounce_port_t *p = _port(pin_map[pin].GPIOx);
+
+	return (p != NULL) && ((p->state & pin_map[pin].pin) != 0);
+}
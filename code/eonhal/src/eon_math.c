@@ -10,6 +10,17 @@
 
 #include "eon_math.h"
 
+/** 
+ ===============================================================================
+              ##### CONSTANTES #####
+ ===============================================================================
+ */
+
+// Cortex-M0+ has no CLZ/RBIT, so a De Bruijn sequence is used instead
+static const uint8_t _debruijn_pos[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9};
+
 /** 
  ===============================================================================
               ##### FUNCIONES #####
@@ -54,3 +65,8 @@ uint16_t highHalfWord(uint32_t w)
 {
   return (uint16_t)((w) >> 16);
 }
+
+uint8_t lowestBitSet(uint32_t w)
+{
+  return _debruijn_pos[((uint32_t)((w & -w) * 0x077CB531U)) >> 27];
+}
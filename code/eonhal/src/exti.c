@@ -8,9 +8,19 @@
   ******************************************************************************
 */
 
+#include <stddef.h>
 #include "exti.h"
 #include "gpio.h"
 #include "pinmap_impl.h"
+#if defined(USE_EXTI_CALLBACKS)
+#include "eon_math.h"
+#endif
+#if defined(USE_EXTI_CAPTURE)
+#include "System.h"
+#if defined(USE_TICKLESS)
+#error "USE_EXTI_CAPTURE needs the SysTick timebase of micros()"
+#endif
+#endif
 
 #if !defined(GPIO_GET_INDEX)
 #define GPIO_GET_INDEX(__GPIOx__) (((__GPIOx__) == (GPIOA)) ? LL_EXTI_CONFIG_PORTA : ((__GPIOx__) == (GPIOB)) ? LL_EXTI_CONFIG_PORTB : ((__GPIOx__) == (GPIOC)) ? 2U : ((__GPIOx__) == (GPIOH)) ? 5U : 6U)
@@ -19,6 +29,32 @@
 #define __HAL_GPIO_EXTI_GET_IT(__EXTI_LINE__) (EXTI->PR & (__EXTI_LINE__))
 #define __HAL_GPIO_EXTI_CLEAR_IT(__EXTI_LINE__) (EXTI->PR = (__EXTI_LINE__))
 
+#if defined(USE_EXTI_CALLBACKS)
+/** 
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+typedef struct
+{
+	extiCallback_t callback;
+	void *ctx;
+	pin_t pin;
+} exti_line_t;
+
+static exti_line_t _lines[16];
+#endif
+
+#if defined(USE_EXTI_CAPTURE)
+// Single producer (interrupt) single consumer (exti_captureRead) queue
+static exti_event_t _events[EXTI_CAPTURE_SIZE];
+static volatile uint16_t _events_head;
+static volatile uint16_t _events_tail;
+static volatile uint32_t _events_lost;
+static uint32_t _capture_lines;
+#endif
+
 /** 
  ===============================================================================
               ##### Private functions #####
@@ -179,6 +215,123 @@ void exti_attachPriority(pin_t pin, pull_t pull, uint8_t priority, uint8_t exti_
 	NVIC_EnableIRQ((IRQn_Type)gpio_irqn);
 }
 
+#if defined(USE_EXTI_CALLBACKS)
+bool exti_attachCallback(pin_t pin, pull_t pull, uint8_t exti_mode, extiCallback_t callback, void *ctx)
+{
+	uint8_t line = lowestBitSet(HAL_Pin_Map()[pin].pin);
+	IRQn_Type gpio_irqn = 0;
+
+	// A line is shared by the same pin number of all the ports
+	if (_lines[line].callback != NULL && _lines[line].pin != pin)
+		return false;
+
+	// The entry is ready before the line can be triggered
+	LL_EXTI_DisableIT_0_31(1UL << line);
+	_lines[line].ctx = ctx;
+	_lines[line].pin = pin;
+	_lines[line].callback = callback;
+#if defined(USE_EXTI_CAPTURE)
+	_capture_lines &= ~(1UL << line);
+#endif
+
+	gpio_irqn = GPIO_EXTIConfig(pin, exti_mode, pull);
+
+	NVIC_SetPriority((IRQn_Type)gpio_irqn, 0);
+	NVIC_EnableIRQ((IRQn_Type)gpio_irqn);
+	return true;
+}
+#endif
+
+#if defined(USE_EXTI_CAPTURE)
+static void _captureNone(void *ctx)
+{
+	(void)ctx;
+}
+
+bool exti_attachCapture(pin_t pin, pull_t pull, uint8_t exti_mode)
+{
+	uint8_t line = lowestBitSet(HAL_Pin_Map()[pin].pin);
+
+	if (!exti_attachCallback(pin, pull, exti_mode, _captureNone, NULL))
+		return false;
+	_capture_lines |= (1UL << line);
+	return true;
+}
+
+uint16_t exti_captureRead(exti_event_t *events, uint16_t max)
+{
+	uint16_t n = 0;
+	uint16_t tail = _events_tail;
+	uint16_t head = _events_head;
+
+	__DMB(); // the events are read after the index that published them
+	while (n < max && tail != head)
+	{
+		events[n++] = _events[tail % EXTI_CAPTURE_SIZE];
+		tail++;
+	}
+	_events_tail = tail; // the slots are free after they were copied
+	return n;
+}
+
+uint32_t exti_captureLost(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t lost;
+
+	__disable_irq();
+	lost = _events_lost;
+	_events_lost = 0;
+	__set_PRIMASK(primask);
+	return lost;
+}
+
+static void _capturePush(uint32_t timestamp, pin_t pin, uint8_t edge)
+{
+	uint16_t head = _events_head;
+	exti_event_t *e;
+
+	if ((uint16_t)(head - _events_tail) >= EXTI_CAPTURE_SIZE)
+	{
+		_events_lost++;
+		return;
+	}
+	e = &_events[head % EXTI_CAPTURE_SIZE];
+	e->timestamp = timestamp;
+	e->pin = pin;
+	e->edge = edge;
+	__DMB(); // the event is written before it's published
+	_events_head = head + 1;
+}
+
+static void _capture(uint32_t rising, uint32_t falling)
+{
+	uint32_t now = micros();
+	uint32_t pending = rising | falling;
+	uint32_t bit;
+	uint8_t line, first;
+
+	while (pending != 0)
+	{
+		line = lowestBitSet(pending);
+		bit = 1UL << line;
+		pending &= pending - 1;
+
+		if ((rising & bit) && (falling & bit))
+		{
+			// Both edges since the last interrupt, the pin level tells the last one
+			first = gpio_read(_lines[line].pin) ? EXTI_EDGE_FALLING : EXTI_EDGE_RISING;
+			_capturePush(now, _lines[line].pin, first);
+			_capturePush(now, _lines[line].pin, first ^ 1);
+		}
+		else
+		{
+			_capturePush(now, _lines[line].pin, (rising & bit) ? EXTI_EDGE_RISING : EXTI_EDGE_FALLING);
+		}
+	}
+}
+#endif
+
 void exti_detach(uint16_t pin)
 {
 	STM32_Pin_Info *pin_map = HAL_Pin_Map();
@@ -196,6 +349,12 @@ void exti_detach(uint16_t pin)
 	LL_EXTI_DisableFallingTrig_0_31(pin_map[pin].pin);
 	LL_EXTI_DisableEvent_0_31(pin_map[pin].pin);
 	LL_EXTI_DisableIT_0_31(pin_map[pin].pin);
+#if defined(USE_EXTI_CALLBACKS)
+	_lines[lowestBitSet(pin_map[pin].pin)].callback = NULL;
+#endif
+#if defined(USE_EXTI_CAPTURE)
+	_capture_lines &= ~(uint32_t)pin_map[pin].pin;
+#endif
 }
 
 void exti_softTrigger(pin_t pin)
@@ -204,6 +363,55 @@ void exti_softTrigger(pin_t pin)
 	LL_EXTI_GenerateSWI_0_31(pin_map[pin].pin);
 }
 
+#if defined(USE_EXTI_CALLBACKS)
+/** 
+ ===============================================================================
+              ##### Interruptions #####
+ ===============================================================================
+ */
+
+// Only the pending lines of the IRQ are visited, lowest line first
+static void _dispatch(uint32_t lines)
+{
+	uint32_t rising = EXTI->RPR1 & lines;
+	uint32_t falling = EXTI->FPR1 & lines;
+	uint32_t pending = rising | falling;
+	uint8_t line;
+
+	EXTI->RPR1 = rising;
+	EXTI->FPR1 = falling;
+#if defined(USE_EXTI_CAPTURE)
+	if ((pending & _capture_lines) != 0)
+	{
+		_capture(rising & _capture_lines, falling & _capture_lines);
+		pending &= ~_capture_lines;
+	}
+#endif
+	while (pending != 0)
+	{
+		line = lowestBitSet(pending);
+		pending &= pending - 1;
+		if (_lines[line].callback != NULL)
+			_lines[line].callback(_lines[line].ctx);
+	}
+}
+
+void EXTI0_1_IRQHandler(void)
+{
+	_dispatch(0x0003);
+}
+
+void EXTI2_3_IRQHandler(void)
+{
+	_dispatch(0x000C);
+}
+
+void EXTI4_15_IRQHandler(void)
+{
+	_dispatch(0xFFF0);
+}
+
+#else
 /** 
  ===============================================================================
    ##### Weak functions #####
@@ -525,3 +733,5 @@ void EXTI4_15_IRQHandler(void)
 #endif
 }
 #endif
+
+#endif
@@ -0,0 +1,348 @@
+/**
+  ******************************************************************************
+  * @file    flashlog.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Flash Data Logger Functions
+  ******************************************************************************
+*/
+
+#include "System.h"
+#include "flashlog.h"
+#include "stm32g0xx_ll_crc.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+#define LOG_ROWS (FLASH_PAGE_SIZE / FLASH_ROW_SIZE)
+#define LOG_MAGIC 0x464C // "FL"
+#define LOG_BLANK 0xFF	 // length of a free position
+#define LOG_RECORD_SIZE(__LEN__) (FLASHLOG_HEADER + (((__LEN__) + 3) & ~3U))
+
+// Page header, at the start of the first row: {magic | check << 16, sequence}
+#define LOG_PAGE_HEADER 8
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static uint16_t _first; // first flash page
+static uint16_t _pages;
+static uint16_t _head; // newest page
+static uint16_t _tail; // oldest page
+static uint32_t _seq;	 // sequence of the newest page
+static uint8_t _rows;	 // rows written in the newest page
+
+static union
+{
+	uint64_t dw[FLASH_ROW_SIZE / 8]; // aligned for flash_programRow()
+	uint32_t w[FLASH_ROW_SIZE / 4];
+	uint8_t b[FLASH_ROW_SIZE];
+} _row;
+static uint16_t _used; // bytes of the RAM row, 0 if it's empty
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+static uint32_t _address(uint16_t page, uint16_t offset)
+{
+	return flash_getPageAddress(_first + page) + offset;
+}
+
+static uint32_t _read32(uint16_t page, uint16_t offset)
+{
+	return *(__IO uint32_t *)_address(page, offset);
+}
+
+static void _crcStart(void)
+{
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+	LL_CRC_SetPolynomialSize(CRC, LL_CRC_POLYLENGTH_32B);
+	LL_CRC_SetPolynomialCoef(CRC, LL_CRC_DEFAULT_CRC32_POLY);
+	LL_CRC_SetInputDataReverseMode(CRC, LL_CRC_INDATA_REVERSE_NONE);
+	LL_CRC_SetOutputDataReverseMode(CRC, LL_CRC_OUTDATA_REVERSE_NONE);
+	LL_CRC_SetInitialData(CRC, LL_CRC_DEFAULT_CRC_INITVALUE);
+	LL_CRC_ResetCRCCalculationUnit(CRC);
+}
+
+static uint16_t _check(uint32_t unix, const uint8_t *data, uint8_t length)
+{
+	uint8_t i;
+
+	_crcStart();
+	LL_CRC_FeedData32(CRC, unix);
+	LL_CRC_FeedData8(CRC, length);
+	for (i = 0; i < length; i++)
+		LL_CRC_FeedData8(CRC, data[i]);
+	return (uint16_t)LL_CRC_ReadData32(CRC);
+}
+
+static uint32_t _pageHeader(uint32_t seq)
+{
+	_crcStart();
+	LL_CRC_FeedData32(CRC, seq);
+	return LOG_MAGIC | ((uint32_t)(uint16_t)LL_CRC_ReadData32(CRC) << 16);
+}
+
+// A page is valid once its first row is written
+static bool _pageSeq(uint16_t page, uint32_t *seq)
+{
+	*seq = _read32(page, 4);
+	return _read32(page, 0) == _pageHeader(*seq);
+}
+
+static bool _rowWritten(uint16_t page, uint8_t row)
+{
+	return *(__IO uint64_t *)_address(page, row * FLASH_ROW_SIZE) != 0xFFFFFFFFFFFFFFFFULL;
+}
+
+static void _rowClear(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < FLASH_ROW_SIZE / 4; i++)
+		_row.w[i] = 0xFFFFFFFFU;
+	_used = 0;
+}
+
+// Erase the page after the newest one, dropping the oldest page if it's that one
+static bool _nextPage(void)
+{
+	uint16_t next = (_head + 1) % _pages;
+	uint32_t seq;
+
+	if (next == _tail && _pageSeq(next, &seq))
+		_tail = (_tail + 1) % _pages;
+	flash_unlock();
+	seq = flash_erasePage(_first + next);
+	flash_lock();
+	if (seq != FLASH_ERR_NONE)
+		return false;
+	_head = next;
+	_seq++;
+	_rows = 0;
+	return true;
+}
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+bool flashlog_init(uint16_t first_page, uint16_t pages)
+{
+	uint32_t ref, seq;
+	uint16_t r, low, high, mid;
+
+	if (pages < 2 || first_page < flash_getFirstFreePage() || first_page + pages > flash_getPages())
+		return false;
+	_first = first_page;
+	_pages = pages;
+	_rowClear();
+
+	// The reference is page 0, or page 1 if page 0 was being rewritten
+	r = 0;
+	if (!_pageSeq(0, &ref))
+	{
+		r = 1;
+		if (!_pageSeq(1, &ref))
+		{
+			// Empty: the first write starts at page 0
+			_head = pages - 1;
+			_tail = 0;
+			_seq = 0xFFFFFFFFU;
+			_rows = LOG_ROWS;
+			return true;
+		}
+	}
+
+	// Pages from the reference to the newest one follow the reference
+	// sequence, the pages after it are older or blank
+	low = r;
+	high = pages - 1;
+	while (low < high)
+	{
+		mid = (low + high + 1) / 2;
+		if (_pageSeq(mid, &seq) && seq == ref + (mid - r))
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	_head = low;
+	_seq = ref + (low - r);
+
+	// The oldest page follows the newest one, skipping a page being rewritten
+	if (_pageSeq((_head + 1) % pages, &seq))
+		_tail = (_head + 1) % pages;
+	else if (_pageSeq((_head + 2) % pages, &seq))
+		_tail = (_head + 2) % pages;
+	else
+		_tail = r;
+
+	// Rows are written in order, the first one always is
+	low = 1;
+	high = LOG_ROWS;
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (_rowWritten(_head, mid))
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	_rows = low;
+	return true;
+}
+
+bool flashlog_write(const void *data, uint8_t length)
+{
+	const uint8_t *src = (const uint8_t *)data;
+	uint32_t unix;
+	uint16_t size = LOG_RECORD_SIZE(length);
+	uint8_t i;
+
+	if (length == 0 || length > FLASHLOG_MAX_LENGTH)
+		return false;
+	if (_used + size > FLASH_ROW_SIZE && !flashlog_flush())
+		return false;
+
+	if (_used == 0)
+	{
+		if (_rows >= LOG_ROWS && !_nextPage())
+			return false;
+		if (_rows == 0)
+		{
+			_row.w[0] = _pageHeader(_seq);
+			_row.w[1] = _seq;
+			_used = LOG_PAGE_HEADER;
+		}
+	}
+
+	unix = rtc_getUnix();
+	_row.w[_used / 4] = unix;
+	_row.w[_used / 4 + 1] = length | ((uint32_t)LOG_BLANK << 8) | ((uint32_t)_check(unix, src, length) << 16);
+	for (i = 0; i < length; i++)
+		_row.b[_used + FLASHLOG_HEADER + i] = src[i];
+	_used += size;
+	return true;
+}
+
+bool flashlog_flush(void)
+{
+	uint32_t error;
+
+	if (_used == 0)
+		return true;
+	flash_unlock();
+	error = flash_programRow(_address(_head, _rows * FLASH_ROW_SIZE), _row.dw);
+	flash_lock();
+	// The row can't be written again, even if it failed
+	_rows++;
+	_rowClear();
+	return error == FLASH_ERR_NONE;
+}
+
+void flashlog_erase(void)
+{
+	uint16_t page;
+
+	flash_unlock();
+	for (page = 0; page < _pages; page++)
+		flash_erasePage(_first + page);
+	flash_lock();
+	_rowClear();
+	_head = _pages - 1;
+	_tail = 0;
+	_seq = 0xFFFFFFFFU;
+	_rows = LOG_ROWS;
+}
+
+void flashlog_rewind(flashlog_cursor_t *cursor)
+{
+	cursor->page = _tail;
+	cursor->offset = LOG_PAGE_HEADER;
+	if (!_pageSeq(_tail, &cursor->seq))
+		cursor->offset = FLASH_PAGE_SIZE; // empty
+}
+
+bool flashlog_read(flashlog_cursor_t *cursor, flashlog_record_t *record)
+{
+	uint32_t seq, info;
+	uint32_t rewind_seq = 0;
+	uint16_t rewind_page = _pages; // no rewind yet
+	uint16_t left;
+
+	while (1)
+	{
+		if (cursor->offset >= FLASH_PAGE_SIZE)
+		{
+			if (cursor->page == _head)
+				return false;
+			cursor->page = (cursor->page + 1) % _pages;
+			cursor->seq++;
+			cursor->offset = LOG_PAGE_HEADER;
+		}
+		if (!_pageSeq(cursor->page, &seq))
+		{
+			// Page lost by a reset while it was erased, or damaged
+			cursor->offset = FLASH_PAGE_SIZE;
+			continue;
+		}
+		if (seq != cursor->seq)
+		{
+			// Overwritten while reading. A rewind to the same tail means the
+			// sequence is broken (interrupted erase), stop instead of looping
+			flashlog_rewind(cursor);
+			if (cursor->page == rewind_page && cursor->seq == rewind_seq)
+				return false;
+			rewind_page = cursor->page;
+			rewind_seq = cursor->seq;
+			continue;
+		}
+
+		left = FLASH_ROW_SIZE - (cursor->offset % FLASH_ROW_SIZE);
+		info = _read32(cursor->page, cursor->offset + 4);
+		if (left < FLASHLOG_HEADER || (uint8_t)info == LOG_BLANK || LOG_RECORD_SIZE((uint8_t)info) > left)
+		{
+			// End of the row
+			cursor->offset += left;
+			continue;
+		}
+
+		record->unix = _read32(cursor->page, cursor->offset);
+		record->length = (uint8_t)info;
+		record->data = (const uint8_t *)_address(cursor->page, cursor->offset + FLASHLOG_HEADER);
+		cursor->offset += LOG_RECORD_SIZE(record->length);
+		if ((uint16_t)(info >> 16) == _check(record->unix, record->data, record->length))
+			return true;
+	}
+}
+
+uint32_t flashlog_dump(void (*write)(unsigned char c))
+{
+	flashlog_cursor_t cursor;
+	flashlog_record_t record;
+	const uint8_t *p;
+	uint32_t count = 0;
+	uint16_t i;
+
+	flashlog_rewind(&cursor);
+	while (flashlog_read(&cursor, &record))
+	{
+		p = record.data - FLASHLOG_HEADER;
+		for (i = 0; i < FLASHLOG_HEADER + record.length; i++)
+			write(p[i]);
+		count++;
+	}
+	return count;
+}
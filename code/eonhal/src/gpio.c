@@ -214,7 +214,7 @@ void gpio_write(pin_t pin, uint8_t state)
 void gpio_toggle(pin_t pin)
 {
 	STM32_Pin_Info *pin_map = HAL_Pin_Map();
-	pin_map[pin].GPIOx->ODR ^= pin_map[pin].pin;
+	gpio_portToggle(pin_map[pin].GPIOx, pin_map[pin].pin);
 }
 
 /**
@@ -228,3 +228,193 @@ uint8_t gpio_read(pin_t pin)
 	STM32_Pin_Info *pin_map = HAL_Pin_Map();
 	return ((pin_map[pin].GPIOx->IDR & pin_map[pin].pin) == 0 ? LOW : HIGH);
 }
+
+/** 
+ ===============================================================================
+              ##### Port Functions #####
+ ===============================================================================
+ */
+
+/**
+ * @brief Get the port of the specified pin
+ * 
+ * @param {pin} Pin
+ * @return {GPIO_TypeDef *} GPIOA, GPIOB, ...
+ */
+GPIO_TypeDef *gpio_port(pin_t pin)
+{
+	return HAL_Pin_Map()[pin].GPIOx;
+}
+
+/**
+ * @brief Get the mask of the specified pin in its port
+ * 
+ * @param {pin} Pin
+ * @return {uint16_t} Pin mask (1 << pin number)
+ */
+uint16_t gpio_pinMask(pin_t pin)
+{
+	return HAL_Pin_Map()[pin].pin;
+}
+
+/**
+ * @brief Resolve a list of pins into a group
+ * 
+ * @param {group} Group handle
+ * @param {pins} Pins, the first one is bit 0 of the value
+ * @param {count} Number of pins (up to GPIO_GROUP_MAX_PINS)
+ * @return {bool} false if there are too many pins or ports
+ */
+bool gpio_groupInit(gpio_group_t *group, const pin_t *pins, uint8_t count)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	uint8_t i, p;
+
+	group->ports = 0;
+	group->count = 0;
+	group->shift = -1;
+	if (count == 0 || count > GPIO_GROUP_MAX_PINS)
+		return false;
+
+	for (i = 0; i < count; i++)
+	{
+		for (p = 0; p < group->ports; p++)
+		{
+			if (group->GPIOx[p] == pin_map[pins[i]].GPIOx)
+				break;
+		}
+		if (p == group->ports)
+		{
+			if (group->ports == GPIO_GROUP_MAX_PORTS)
+				return false;
+			group->GPIOx[p] = pin_map[pins[i]].GPIOx;
+			group->mask[p] = 0;
+			group->ports++;
+		}
+		group->mask[p] |= pin_map[pins[i]].pin;
+		group->pin[i] = pin_map[pins[i]].pin;
+		group->port[i] = p;
+	}
+	group->count = count;
+
+	// Consecutive pins of one port (e.g. PB8..PB15) are written with a shift
+	if (group->ports == 1)
+	{
+		for (i = 1; i < count; i++)
+		{
+			if (group->pin[i] != (uint16_t)(group->pin[0] << i))
+				break;
+		}
+		if (i == count)
+		{
+			while ((group->pin[0] >> (group->shift + 1)) != 0)
+				group->shift++;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Configure all the pins of a group
+ * 
+ * @param {group} Group handle
+ * @param {mode} INPUT, ANALOG, OUTPUT_PP or OUTPUT_OD
+ * @param {pull} NOPULL, PULLDOWN or PULLUP 
+ * @param {speed} SPEED_LOW, SPEED_MEDIUM, SPEED_HIGH, SPEED_VER_HIGH
+ */
+void gpio_groupMode(gpio_group_t *group, mode_t mode, pull_t pull, speed_t speed)
+{
+	uint8_t p;
+	uint16_t mask;
+
+	for (p = 0; p < group->ports; p++)
+	{
+		if (group->GPIOx[p] == GPIOA)
+			SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOAEN);
+#ifdef GPIOB
+		if (group->GPIOx[p] == GPIOB)
+			SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOBEN);
+#endif
+#ifdef GPIOC
+		if (group->GPIOx[p] == GPIOC)
+			SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOCEN);
+#endif
+#ifdef GPIOD
+		if (group->GPIOx[p] == GPIOD)
+			SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIODEN);
+#endif
+#ifdef GPIOE
+		if (group->GPIOx[p] == GPIOE)
+			SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOEEN);
+#endif
+#ifdef GPIOF
+		if (group->GPIOx[p] == GPIOF)
+			SET_BIT(RCC->IOPENR, RCC_IOPENR_GPIOFEN);
+#endif
+
+		for (mask = 1; mask != 0; mask <<= 1)
+		{
+			if ((group->mask[p] & mask) == 0)
+				continue;
+			LL_GPIO_SetPinMode(group->GPIOx[p], mask, (mode & GPIO_MODE));
+			if (mode != INPUT && mode != ANALOG)
+			{
+				LL_GPIO_SetPinSpeed(group->GPIOx[p], mask, speed);
+				LL_GPIO_SetPinOutputType(group->GPIOx[p], mask, ((mode & GPIO_OUTPUT_TYPE) >> 4));
+			}
+			LL_GPIO_SetPinPull(group->GPIOx[p], mask, pull);
+		}
+	}
+}
+
+/**
+ * @brief Write a value to a group, one store per port
+ * 
+ * @param {group} Group handle
+ * @param {value} Value, bit n is written to the pin n of the group
+ */
+void gpio_groupWrite(gpio_group_t *group, uint16_t value)
+{
+	uint16_t set[GPIO_GROUP_MAX_PORTS] = {0};
+	uint8_t i;
+
+	if (group->shift >= 0)
+	{
+		gpio_portWrite(group->GPIOx[0], group->mask[0], (uint16_t)(value << group->shift));
+		return;
+	}
+
+	for (i = 0; i < group->count; i++)
+	{
+		if (value & (1U << i))
+			set[group->port[i]] |= group->pin[i];
+	}
+	for (i = 0; i < group->ports; i++)
+		gpio_portWrite(group->GPIOx[i], group->mask[i], set[i]);
+}
+
+/**
+ * @brief Read the value of a group
+ * 
+ * @param {group} Group handle
+ * @return {uint16_t} Value, bit n is the state of the pin n of the group
+ */
+uint16_t gpio_groupRead(gpio_group_t *group)
+{
+	uint16_t idr[GPIO_GROUP_MAX_PORTS];
+	uint16_t value = 0;
+	uint8_t i;
+
+	if (group->shift >= 0)
+		return gpio_portRead(group->GPIOx[0], group->mask[0]) >> group->shift;
+
+	// Sample all the ports first, so the value is as coherent as possible
+	for (i = 0; i < group->ports; i++)
+		idr[i] = gpio_portRead(group->GPIOx[i], group->mask[i]);
+	for (i = 0; i < group->count; i++)
+	{
+		if (idr[group->port[i]] & group->pin[i])
+			value |= (1U << i);
+	}
+	return value;
+}
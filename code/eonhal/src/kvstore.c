@@ -0,0 +1,252 @@
+/**
+  ******************************************************************************
+  * @file    kvstore.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Key-Value Store Functions
+  ******************************************************************************
+*/
+
+#include <stddef.h>
+#include "System.h"
+#include "stm32g0xx_ll_crc.h"
+#include "kvstore.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+#if (KVSTORE_ADDRESS % 4) != 0 || (KVSTORE_SIZE % 4) != 0 || (KVSTORE_ADDRESS + KVSTORE_SIZE) > VEEPROM_SIZE
+#error "The kvstore window must be word aligned and inside the virtual EEPROM"
+#endif
+
+// Record: {key (2), length (1), check (1), CRC (4), value, padding to a word}
+// The check covers the header, the CRC the key, length and value: a reset in
+// veeprom_commit() can leave a new header in front of an old value.
+#define KV_HEADER 8
+#define KV_RECORD_SIZE(__LEN__) (KV_HEADER + (((__LEN__) + 3) & ~3U))
+#define KV_CHECK(__KEY__, __LEN__) ((uint8_t)((__KEY__) ^ ((__KEY__) >> 8) ^ (__LEN__) ^ 0x5A))
+#define KV_DELETED 0 // length of a deleted key
+
+typedef struct
+{
+	uint16_t key;
+	uint16_t offset; // latest record
+} kv_index_t;
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static kv_index_t _index[KVSTORE_INDEX_SIZE];
+static uint16_t _keys;
+static uint16_t _end; // first free byte of the window
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+static uint8_t _length(uint16_t offset)
+{
+	return veeprom_readByte(KVSTORE_ADDRESS + offset + 2);
+}
+
+// CRC-32 of the key, length and value of the record at offset
+static uint32_t _crc(uint16_t offset)
+{
+	uint8_t length = _length(offset);
+	uint8_t i;
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+	LL_CRC_SetPolynomialSize(CRC, LL_CRC_POLYLENGTH_32B);
+	LL_CRC_SetPolynomialCoef(CRC, LL_CRC_DEFAULT_CRC32_POLY);
+	LL_CRC_SetInputDataReverseMode(CRC, LL_CRC_INDATA_REVERSE_NONE);
+	LL_CRC_SetOutputDataReverseMode(CRC, LL_CRC_OUTDATA_REVERSE_NONE);
+	LL_CRC_SetInitialData(CRC, LL_CRC_DEFAULT_CRC_INITVALUE);
+	LL_CRC_ResetCRCCalculationUnit(CRC);
+	LL_CRC_FeedData32(CRC, veeprom_readHalfWord(KVSTORE_ADDRESS + offset) | ((uint32_t)length << 16));
+	for (i = 0; i < length; i++)
+		LL_CRC_FeedData8(CRC, veeprom_readByte(KVSTORE_ADDRESS + offset + KV_HEADER + i));
+	return LL_CRC_ReadData32(CRC);
+}
+
+static kv_index_t *_find(uint16_t key)
+{
+	uint16_t i = ((uint16_t)(key * 40503U) >> 8) & (KVSTORE_INDEX_SIZE - 1);
+
+	// Linear probing, the table always has a free entry
+	while (_index[i].key != KVSTORE_KEY_NONE && _index[i].key != key)
+		i = (i + 1) & (KVSTORE_INDEX_SIZE - 1);
+	return &_index[i];
+}
+
+// Scan the records from the start of the window
+static void _build(void)
+{
+	uint16_t offset = 0;
+	uint16_t key, i;
+	uint8_t length;
+	kv_index_t *entry;
+
+	for (i = 0; i < KVSTORE_INDEX_SIZE; i++)
+		_index[i].key = KVSTORE_KEY_NONE;
+	_keys = 0;
+
+	while (offset + KV_HEADER <= KVSTORE_SIZE)
+	{
+		key = veeprom_readHalfWord(KVSTORE_ADDRESS + offset);
+		length = _length(offset);
+		// A torn record ends the log, the previous record of its key stays
+		if (key == KVSTORE_KEY_NONE || veeprom_readByte(KVSTORE_ADDRESS + offset + 3) != KV_CHECK(key, length) ||
+				offset + KV_RECORD_SIZE(length) > KVSTORE_SIZE || veeprom_readWord(KVSTORE_ADDRESS + offset + 4) != _crc(offset))
+			break;
+		entry = _find(key);
+		if (entry->key == KVSTORE_KEY_NONE)
+		{
+			if (_keys == KVSTORE_INDEX_SIZE - 1)
+				break;
+			entry->key = key;
+			_keys++;
+		}
+		entry->offset = offset;
+		offset += KV_RECORD_SIZE(length);
+	}
+	_end = offset;
+}
+
+// Move the latest record of each key to the start of the window
+static void _compact(void)
+{
+	uint16_t offset = 0;
+	uint16_t dst = 0;
+	uint16_t key, i, size;
+	kv_index_t *entry;
+
+	while (offset < _end)
+	{
+		key = veeprom_readHalfWord(KVSTORE_ADDRESS + offset);
+		size = KV_RECORD_SIZE(_length(offset));
+		entry = _find(key);
+		if (entry->key == key && entry->offset == offset && _length(offset) != KV_DELETED)
+		{
+			for (i = 0; i < size && dst != offset; i++)
+				veeprom_writeByte(KVSTORE_ADDRESS + dst + i, veeprom_readByte(KVSTORE_ADDRESS + offset + i));
+			dst += size;
+		}
+		offset += size;
+	}
+	for (i = dst; i < _end; i++)
+		veeprom_writeByte(KVSTORE_ADDRESS + i, 0xFF);
+	_build();
+}
+
+static bool _append(uint16_t key, const uint8_t *value, uint8_t length)
+{
+	uint16_t size = KV_RECORD_SIZE(length);
+	uint16_t address;
+	kv_index_t *entry = _find(key);
+	uint8_t i;
+
+	// Deleted keys keep their index slot until the window is compacted
+	if ((entry->key == KVSTORE_KEY_NONE && _keys == KVSTORE_INDEX_SIZE - 1) || _end + size > KVSTORE_SIZE)
+	{
+		_compact();
+		entry = _find(key);
+		if (entry->key == KVSTORE_KEY_NONE && _keys == KVSTORE_INDEX_SIZE - 1)
+			return false;
+		if (_end + size > KVSTORE_SIZE)
+			return false;
+	}
+
+	address = KVSTORE_ADDRESS + _end;
+	veeprom_writeHalfWord(address, key);
+	veeprom_writeByte(address + 2, length);
+	veeprom_writeByte(address + 3, KV_CHECK(key, length));
+	for (i = 0; i < length; i++)
+		veeprom_writeByte(address + KV_HEADER + i, value[i]);
+	veeprom_writeWord(address + 4, _crc(_end));
+
+	if (entry->key == KVSTORE_KEY_NONE)
+	{
+		entry->key = key;
+		_keys++;
+	}
+	entry->offset = _end;
+	_end += size;
+	return true;
+}
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+void kvstore_init(void)
+{
+	_build();
+}
+
+bool kvstore_set(uint16_t key, const void *value, uint8_t length)
+{
+	const uint8_t *v = (const uint8_t *)value;
+	kv_index_t *entry = _find(key);
+	uint16_t address;
+	uint8_t i;
+
+	if (key == KVSTORE_KEY_NONE || length == KV_DELETED)
+		return false;
+
+	// Same value, nothing to write
+	if (entry->key == key && _length(entry->offset) == length)
+	{
+		address = KVSTORE_ADDRESS + entry->offset + KV_HEADER;
+		for (i = 0; i < length && veeprom_readByte(address + i) == v[i]; i++)
+			;
+		if (i == length)
+			return true;
+	}
+	return _append(key, v, length);
+}
+
+uint8_t kvstore_get(uint16_t key, void *value, uint8_t max_length)
+{
+	kv_index_t *entry = _find(key);
+	uint8_t *v = (uint8_t *)value;
+	uint8_t length, i;
+
+	if (entry->key != key)
+		return 0;
+	length = _length(entry->offset);
+	for (i = 0; i < length && i < max_length; i++)
+		v[i] = veeprom_readByte(KVSTORE_ADDRESS + entry->offset + KV_HEADER + i);
+	return length;
+}
+
+void kvstore_delete(uint16_t key)
+{
+	kv_index_t *entry = _find(key);
+
+	if (entry->key == key && _length(entry->offset) != KV_DELETED)
+		_append(key, NULL, KV_DELETED);
+}
+
+uint16_t kvstore_free(void)
+{
+	uint16_t used = 0;
+	uint16_t i;
+
+	for (i = 0; i < KVSTORE_INDEX_SIZE; i++)
+	{
+		if (_index[i].key != KVSTORE_KEY_NONE && _length(_index[i].offset) != KV_DELETED)
+			used += KV_RECORD_SIZE(_length(_index[i].offset));
+	}
+	return KVSTORE_SIZE - used;
+}
@@ -11,8 +11,10 @@
 #include "pwm.h"
 #include "gpio.h"
 #include "tim.h"
+#include "System.h"
 #include "pinmap_impl.h"
 #include "stm32g0xx_ll_bus.h"
+#include <stdbool.h>
 
 /** 
  ===============================================================================
@@ -95,52 +97,91 @@ static void pwm_enableTim(TIM_TypeDef *TIMx)
 #endif
 }
 
-/** 
- ===============================================================================
-              ##### Public Functions #####
- ===============================================================================
- */
+static void pwm_setCompare(TIM_TypeDef *TIMx, uint32_t channel, uint32_t val)
+{
+	if (channel == LL_TIM_CHANNEL_CH1)
+		TIMx->CCR1 = val;
+	else if (channel == LL_TIM_CHANNEL_CH2)
+		TIMx->CCR2 = val;
+	else if (channel == LL_TIM_CHANNEL_CH3)
+		TIMx->CCR3 = val;
+	else if (channel == LL_TIM_CHANNEL_CH4)
+		TIMx->CCR4 = val;
+}
 
-void pwm_init(TIM_TypeDef *TIMx, uint32_t prescaler, uint32_t period)
+// Compare value of 100%. When ARR is the counter maximum CCR can't hold
+// ARR + 1 (it would wrap to 0%), the output is then inactive for 1 count
+static uint32_t pwm_counts(TIM_TypeDef *TIMx)
 {
-	LL_TIM_BDTR_InitTypeDef TIM_BDTRInitStruct = {0};
-	LL_TIM_InitTypeDef pwm_time_base;
+	uint32_t max = IS_TIM_32B_COUNTER_INSTANCE(TIMx) ? 0xFFFFFFFFUL : 0xFFFFUL;
 
-	pwm_enableTim(TIMx);
-	pwm_time_base.ClockDivision = LL_TIM_CLOCKDIVISION_DIV1;
-	pwm_time_base.CounterMode = LL_TIM_COUNTERMODE_UP;
-	pwm_time_base.Autoreload = period - 1;
-	pwm_time_base.Prescaler = prescaler - 1;
-	LL_TIM_Init(TIMx, &pwm_time_base);
-	LL_TIM_SetClockSource(TIMx, LL_TIM_CLOCKSOURCE_INTERNAL);
-	LL_TIM_EnableARRPreload(TIMx);
+	return (TIMx->ARR >= max) ? max : TIMx->ARR + 1;
+}
 
-	TIM_BDTRInitStruct.OSSRState = LL_TIM_OSSR_ENABLE;
-	TIM_BDTRInitStruct.OSSIState = LL_TIM_OSSI_ENABLE;
-	TIM_BDTRInitStruct.LockLevel = LL_TIM_LOCKLEVEL_OFF;
-	TIM_BDTRInitStruct.DeadTime = 0;
-	TIM_BDTRInitStruct.BreakState = LL_TIM_BREAK_DISABLE;
-	TIM_BDTRInitStruct.BreakPolarity = LL_TIM_BREAK_POLARITY_HIGH;
-	TIM_BDTRInitStruct.BreakFilter = LL_TIM_BREAK_FILTER_FDIV1;
-	TIM_BDTRInitStruct.AutomaticOutput = LL_TIM_AUTOMATICOUTPUT_ENABLE;
-	LL_TIM_BDTR_Init(TIMx, &TIM_BDTRInitStruct);
+// Complementary outputs and break inputs aren't in the pin map
+#define PWM_PIN_BKIN 0xFFFE
+#define PWM_PIN_BKIN2 0xFFFF
 
-	LL_TIM_EnableCounter(TIMx);
+typedef struct
+{
+	pin_t pin;
+	TIM_TypeDef *TIMx;
+	uint16_t function; // LL_TIM_CHANNEL_CHxN or PWM_PIN_BKINx
+	uint8_t af;
+} pwm_afPin_t;
+
+static const pwm_afPin_t _afPins[] = {
+		{PA6, TIM1, PWM_PIN_BKIN, AF_2},
+		{PA7, TIM1, LL_TIM_CHANNEL_CH1N, AF_2},
+		{PA11, TIM1, PWM_PIN_BKIN2, AF_5},
+		{PB0, TIM1, LL_TIM_CHANNEL_CH2N, AF_2},
+		{PB1, TIM1, LL_TIM_CHANNEL_CH3N, AF_2},
+		{PB4, TIM17, PWM_PIN_BKIN, AF_5},
+		{PB5, TIM16, PWM_PIN_BKIN, AF_2},
+		{PB6, TIM16, LL_TIM_CHANNEL_CH1N, AF_2},
+		{PB7, TIM17, LL_TIM_CHANNEL_CH1N, AF_2},
+		{PA10, TIM17, PWM_PIN_BKIN, AF_5},
+#if defined(TIM15)
+		{PA1, TIM15, LL_TIM_CHANNEL_CH1N, AF_5},
+		{PA9, TIM15, PWM_PIN_BKIN, AF_5},
+#endif
+#if defined(PB12)
+		{PB12, TIM1, PWM_PIN_BKIN, AF_2},
+		{PB13, TIM1, LL_TIM_CHANNEL_CH1N, AF_2},
+		{PB14, TIM1, LL_TIM_CHANNEL_CH2N, AF_2},
+		{PB15, TIM1, LL_TIM_CHANNEL_CH3N, AF_2},
+#if defined(TIM15)
+		{PB12, TIM15, PWM_PIN_BKIN, AF_5},
+		{PB13, TIM15, LL_TIM_CHANNEL_CH1N, AF_5},
+#endif
+#endif
+};
+
+static bool pwm_pinAF(pin_t pin, TIM_TypeDef *TIMx, uint16_t function)
+{
+	uint8_t i;
+
+	for (i = 0; i < (sizeof(_afPins) / sizeof(_afPins[0])); i++)
+	{
+		if (_afPins[i].pin == pin && _afPins[i].TIMx == TIMx && _afPins[i].function == function)
+		{
+			gpio_modeAF(pin, AF_PP, NOPULL, _afPins[i].af);
+			return true;
+		}
+	}
+	return false;
 }
 
-void pwm_init1KHz(TIM_TypeDef *TIMx)
+static void pwm_timeBaseInit(TIM_TypeDef *TIMx, uint32_t prescaler, uint32_t autoreload, uint32_t counter_mode)
 {
-	uint32_t timer_source_freq;
 	LL_TIM_BDTR_InitTypeDef TIM_BDTRInitStruct = {0};
 	LL_TIM_InitTypeDef pwm_time_base;
 
-	timer_source_freq = tim_getSrcClk(TIMx);
-
 	pwm_enableTim(TIMx);
 	pwm_time_base.ClockDivision = LL_TIM_CLOCKDIVISION_DIV1;
-	pwm_time_base.CounterMode = LL_TIM_COUNTERMODE_UP;
-	pwm_time_base.Autoreload = 999; /* 1000 - 1 */
-	pwm_time_base.Prescaler = (timer_source_freq / 1000000) - 1;
+	pwm_time_base.CounterMode = counter_mode;
+	pwm_time_base.Autoreload = autoreload;
+	pwm_time_base.Prescaler = prescaler - 1;
 	LL_TIM_Init(TIMx, &pwm_time_base);
 	LL_TIM_SetClockSource(TIMx, LL_TIM_CLOCKSOURCE_INTERNAL);
 	LL_TIM_EnableARRPreload(TIMx);
@@ -156,36 +197,47 @@ void pwm_init1KHz(TIM_TypeDef *TIMx)
 	LL_TIM_BDTR_Init(TIMx, &TIM_BDTRInitStruct);
 
 	LL_TIM_EnableCounter(TIMx);
+
+	// The outputs freeze in Stop mode, tim_off() releases it
+	power_require(tim_powerUser(TIMx), POWER_MODE_SLEEP);
+}
+
+/** 
+ ===============================================================================
+              ##### Public Functions #####
+ ===============================================================================
+ */
+
+void pwm_init(TIM_TypeDef *TIMx, uint32_t prescaler, uint32_t period)
+{
+	pwm_timeBaseInit(TIMx, prescaler, period - 1, LL_TIM_COUNTERMODE_UP);
+}
+
+void pwm_init1KHz(TIM_TypeDef *TIMx)
+{
+	pwm_init(TIMx, tim_getSrcClk(TIMx) / 1000000, 1000);
 }
 
 void pwm_init500Hz(TIM_TypeDef *TIMx)
 {
-	uint32_t timer_source_freq;
-	LL_TIM_BDTR_InitTypeDef TIM_BDTRInitStruct = {0};
-	LL_TIM_InitTypeDef pwm_time_base;
+	pwm_init(TIMx, 2 * tim_getSrcClk(TIMx) / 1000000, 1000);
+}
 
-	timer_source_freq = tim_getSrcClk(TIMx);
+uint8_t pwm_initFreq(TIM_TypeDef *TIMx, uint32_t hz, uint8_t min_resolution_bits)
+{
+	timebase_t timebase;
+	uint8_t bits = 0;
 
-	pwm_enableTim(TIMx);
-	pwm_time_base.ClockDivision = LL_TIM_CLOCKDIVISION_DIV1;
-	pwm_time_base.CounterMode = LL_TIM_COUNTERMODE_UP;
-	pwm_time_base.Autoreload = 999; /* 1000 - 1 */
-	pwm_time_base.Prescaler = (2 * timer_source_freq / 1000000) - 1;
-	LL_TIM_Init(TIMx, &pwm_time_base);
-	LL_TIM_SetClockSource(TIMx, LL_TIM_CLOCKSOURCE_INTERNAL);
-	LL_TIM_EnableARRPreload(TIMx);
+	tim_getMinPrescalerAndMaxPeriod(&timebase, TIMx, hz);
 
-	TIM_BDTRInitStruct.OSSRState = LL_TIM_OSSR_ENABLE;
-	TIM_BDTRInitStruct.OSSIState = LL_TIM_OSSI_ENABLE;
-	TIM_BDTRInitStruct.LockLevel = LL_TIM_LOCKLEVEL_OFF;
-	TIM_BDTRInitStruct.DeadTime = 0;
-	TIM_BDTRInitStruct.BreakState = LL_TIM_BREAK_DISABLE;
-	TIM_BDTRInitStruct.BreakPolarity = LL_TIM_BREAK_POLARITY_HIGH;
-	TIM_BDTRInitStruct.BreakFilter = LL_TIM_BREAK_FILTER_FDIV1;
-	TIM_BDTRInitStruct.AutomaticOutput = LL_TIM_AUTOMATICOUTPUT_ENABLE;
-	LL_TIM_BDTR_Init(TIMx, &TIM_BDTRInitStruct);
+	// The resolution is given by the number of counts per period
+	while (bits < 16 && (timebase.period >> (bits + 1)) != 0)
+		bits++;
+	if (bits < min_resolution_bits)
+		return 0;
 
-	LL_TIM_EnableCounter(TIMx);
+	pwm_init(TIMx, timebase.prescaler, timebase.period);
+	return bits;
 }
 
 /** 
@@ -221,12 +273,307 @@ void pwm_write(pin_t pin, uint16_t val)
 	STM32_Pin_Info *pin_map = HAL_Pin_Map();
 	if (val > pin_map[pin].TIMx->ARR)
 		val = pin_map[pin].TIMx->ARR;
-	if (pin_map[pin].timerCh == LL_TIM_CHANNEL_CH1)
-		pin_map[pin].TIMx->CCR1 = val;
-	else if (pin_map[pin].timerCh == LL_TIM_CHANNEL_CH2)
-		pin_map[pin].TIMx->CCR2 = val;
+	pwm_setCompare(pin_map[pin].TIMx, pin_map[pin].timerCh, val);
+}
+
+void pwm_writeDuty(pin_t pin, uint16_t duty)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	uint32_t counts = pwm_counts(pin_map[pin].TIMx);
+
+	// 0xFFFF is 100%, the compare value above ARR keeps the output always active
+	if (duty == 0xFFFF)
+		pwm_setCompare(pin_map[pin].TIMx, pin_map[pin].timerCh, counts);
+	else
+		pwm_setCompare(pin_map[pin].TIMx, pin_map[pin].timerCh, ((uint32_t)duty * counts) >> 16);
+}
+
+/** 
+ ===============================================================================
+              ##### Fast write functions #####
+ ===============================================================================
+ */
+
+void pwm_channelInit(pwm_channel_t *ch, pin_t pin)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	TIM_TypeDef *TIMx = pin_map[pin].TIMx;
+
+	ch->TIMx = TIMx;
+	ch->counts = pwm_counts(TIMx);
+	if (pin_map[pin].timerCh == LL_TIM_CHANNEL_CH2)
+		ch->ccr = &TIMx->CCR2;
 	else if (pin_map[pin].timerCh == LL_TIM_CHANNEL_CH3)
-		pin_map[pin].TIMx->CCR3 = val;
+		ch->ccr = &TIMx->CCR3;
 	else if (pin_map[pin].timerCh == LL_TIM_CHANNEL_CH4)
-		pin_map[pin].TIMx->CCR4 = val;
+		ch->ccr = &TIMx->CCR4;
+	else
+		ch->ccr = &TIMx->CCR1;
+}
+
+void pwm_writeAll(TIM_TypeDef *TIMx, uint16_t ccr1, uint16_t ccr2, uint16_t ccr3, uint16_t ccr4)
+{
+	// The preloaded values aren't transferred while the update event is disabled
+	pwm_batchBegin(TIMx);
+	TIMx->CCR1 = ccr1;
+	if (IS_TIM_CC2_INSTANCE(TIMx))
+		TIMx->CCR2 = ccr2;
+	if (IS_TIM_CC3_INSTANCE(TIMx))
+	{
+		TIMx->CCR3 = ccr3;
+		TIMx->CCR4 = ccr4;
+	}
+	pwm_batchEnd(TIMx);
+}
+
+/** 
+ ===============================================================================
+              ##### One pulse functions #####
+ ===============================================================================
+ */
+
+bool pwm_pulseInit(pin_t pin, uint32_t delay_us, uint32_t width_us, uint32_t PULSE_TRIGGER_x, uint8_t PULSE_MODE_x)
+{
+	LL_TIM_InitTypeDef pwm_time_base;
+	LL_TIM_OC_InitTypeDef pwm_output_compare = {0};
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	TIM_TypeDef *TIMx = pin_map[pin].TIMx;
+	uint32_t cycles_us, divider, delay_ticks, width_ticks;
+	bool external = (PULSE_TRIGGER_x != PULSE_TRIGGER_SOFTWARE);
+
+	// TIM14/16/17 have no slave controller to start on an external trigger
+	if (external && !IS_TIM_SLAVE_INSTANCE(TIMx))
+		return false;
+
+	pwm_enableTim(TIMx);
+	LL_TIM_DisableCounter(TIMx);
+
+	// Smallest prescaler where delay + width fits in the 16 bits counter
+	cycles_us = tim_getSrcClk(TIMx) / 1000000;
+	divider = (((delay_us + width_us) * cycles_us) >> 16) + 1;
+	delay_ticks = (delay_us * cycles_us) / divider;
+	width_ticks = (width_us * cycles_us) / divider;
+	if (delay_ticks == 0)
+		delay_ticks = 1; // the output would be active before the trigger
+	if (width_ticks == 0)
+		width_ticks = 1;
+
+	pwm_time_base.ClockDivision = LL_TIM_CLOCKDIVISION_DIV1;
+	pwm_time_base.CounterMode = LL_TIM_COUNTERMODE_UP;
+	pwm_time_base.Autoreload = delay_ticks + width_ticks - 1;
+	pwm_time_base.Prescaler = divider - 1;
+	pwm_time_base.RepetitionCounter = 0;
+	LL_TIM_Init(TIMx, &pwm_time_base);
+	LL_TIM_SetClockSource(TIMx, LL_TIM_CLOCKSOURCE_INTERNAL);
+	LL_TIM_SetOnePulseMode(TIMx, LL_TIM_ONEPULSEMODE_SINGLE);
+
+	// Output inactive during the delay, active until the update event.
+	// Retriggerable OPM only works with the slave controller, software
+	// retriggers reset the counter in pwm_pulseTrigger() instead
+	gpio_modePWM(pin);
+	pwm_output_compare.OCMode = (external && PULSE_MODE_x == PULSE_MODE_RETRIGGERABLE) ? LL_TIM_OCMODE_RETRIG_OPM2 : LL_TIM_OCMODE_PWM2;
+	pwm_output_compare.OCPolarity = LL_TIM_OCPOLARITY_HIGH;
+	pwm_output_compare.OCState = LL_TIM_OCSTATE_ENABLE;
+	pwm_output_compare.OCNState = LL_TIM_OCSTATE_DISABLE;
+	pwm_output_compare.CompareValue = delay_ticks;
+	LL_TIM_OC_Init(TIMx, pin_map[pin].timerCh, &pwm_output_compare);
+	LL_TIM_OC_DisablePreload(TIMx, pin_map[pin].timerCh);
+
+	if (IS_TIM_SLAVE_INSTANCE(TIMx))
+	{
+		if (!external)
+		{
+			LL_TIM_SetSlaveMode(TIMx, LL_TIM_SLAVEMODE_DISABLED);
+		}
+		else
+		{
+			LL_TIM_SetTriggerInput(TIMx, PULSE_TRIGGER_x);
+			LL_TIM_SetSlaveMode(TIMx, (PULSE_MODE_x == PULSE_MODE_RETRIGGERABLE) ? LL_TIM_SLAVEMODE_COMBINED_RESETTRIGGER : LL_TIM_SLAVEMODE_TRIGGER);
+		}
+	}
+
+	if (IS_TIM_BREAK_INSTANCE(TIMx))
+		LL_TIM_EnableAllOutputs(TIMx);
+	return true;
+}
+
+void pwm_pulseTriggerPin(pin_t pin, uint8_t PULSE_EDGE_x)
+{
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+
+	gpio_modePWM(pin);
+	LL_TIM_IC_SetActiveInput(pin_map[pin].TIMx, pin_map[pin].timerCh, LL_TIM_ACTIVEINPUT_DIRECTTI);
+	LL_TIM_IC_SetFilter(pin_map[pin].TIMx, pin_map[pin].timerCh, LL_TIM_IC_FILTER_FDIV1);
+	LL_TIM_IC_SetPolarity(pin_map[pin].TIMx, pin_map[pin].timerCh, (PULSE_EDGE_x == PULSE_EDGE_FALLING) ? LL_TIM_IC_POLARITY_FALLING : LL_TIM_IC_POLARITY_RISING);
+}
+
+void pwm_pulseTrigger(pin_t pin, uint8_t PULSE_MODE_x)
+{
+	TIM_TypeDef *TIMx = HAL_Pin_Map()[pin].TIMx;
+
+	if (PULSE_MODE_x == PULSE_MODE_RETRIGGERABLE)
+	{
+		// Restart the delay from 0, the update event stops the counter
+		LL_TIM_GenerateEvent_UPDATE(TIMx);
+		LL_TIM_EnableCounter(TIMx);
+	}
+	else if (!LL_TIM_IsEnabledCounter(TIMx))
+	{
+		LL_TIM_EnableCounter(TIMx);
+	}
+}
+
+bool pwm_pulseIsBusy(pin_t pin)
+{
+	return LL_TIM_IsEnabledCounter(HAL_Pin_Map()[pin].TIMx) == 1;
+}
+
+/** 
+ ===============================================================================
+              ##### Complementary functions #####
+ ===============================================================================
+ */
+
+uint8_t pwm_initCenterAligned(TIM_TypeDef *TIMx, uint32_t hz, uint8_t min_resolution_bits)
+{
+	timebase_t timebase;
+	uint8_t bits = 0;
+
+	// The counter counts up and down, so a PWM period is 2 counter periods
+	tim_getMinPrescalerAndMaxPeriod(&timebase, TIMx, 2 * hz);
+	if (timebase.period > 0xFFFF)
+		timebase.period = 0xFFFF;
+
+	while (bits < 16 && (timebase.period >> (bits + 1)) != 0)
+		bits++;
+	if (bits < min_resolution_bits)
+		return 0;
+
+	pwm_timeBaseInit(TIMx, timebase.prescaler, timebase.period, LL_TIM_COUNTERMODE_CENTER_UP);
+	return bits;
+}
+
+uint32_t pwm_setDeadTime(TIM_TypeDef *TIMx, uint32_t ns)
+{
+	uint32_t clk = tim_getSrcClk(TIMx);
+	uint64_t ns_ticks = (((uint64_t)ns * clk) + 999999999) / 1000000000; // rounded up, never shorter than asked
+	uint32_t ticks = (ns_ticks > 1008) ? 1008 : (uint32_t)ns_ticks;
+	uint64_t applied;
+	uint32_t dtg;
+
+	// Computed in Hz, the timer clock can be below 1 MHz (HSISYS divided)
+	if (clk == 0)
+		return 0;
+
+	// DTG encoding: 0..127 x1, 128..254 x2, 256..504 x8, 512..1008 x16 (tDTS ticks)
+	if (ticks <= 127)
+	{
+		dtg = ticks;
+	}
+	else if (ticks <= 254)
+	{
+		ticks = (ticks + 1) & ~1UL;
+		dtg = 0x80 | ((ticks >> 1) - 64);
+	}
+	else if (ticks <= 504)
+	{
+		ticks = (ticks + 7) & ~7UL;
+		dtg = 0xC0 | ((ticks >> 3) - 32);
+	}
+	else
+	{
+		ticks = (ticks + 15) & ~15UL;
+		dtg = 0xE0 | ((ticks >> 4) - 32);
+	}
+
+	LL_TIM_OC_SetDeadTime(TIMx, dtg);
+	applied = ((uint64_t)ticks * 1000000000) / clk;
+	return (applied > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : (uint32_t)applied;
+}
+
+void pwm_pinEnableComplementary(pin_t pin, pin_t pinN)
+{
+	LL_TIM_OC_InitTypeDef pwm_output_compare = {0};
+	STM32_Pin_Info *pin_map = HAL_Pin_Map();
+	TIM_TypeDef *TIMx = pin_map[pin].TIMx;
+	uint32_t channel = pin_map[pin].timerCh;
+
+	// CHxN enable bit is the next one after CHx
+	if (!pwm_pinAF(pinN, TIMx, channel << 2))
+		return;
+	gpio_modePWM(pin);
+
+	pwm_output_compare.OCMode = LL_TIM_OCMODE_PWM1;
+	pwm_output_compare.OCPolarity = LL_TIM_OCPOLARITY_HIGH;
+	pwm_output_compare.OCNPolarity = LL_TIM_OCPOLARITY_HIGH;
+	pwm_output_compare.OCIdleState = LL_TIM_OCIDLESTATE_LOW;
+	pwm_output_compare.OCNIdleState = LL_TIM_OCIDLESTATE_LOW;
+	pwm_output_compare.OCState = LL_TIM_OCSTATE_ENABLE;
+	pwm_output_compare.OCNState = LL_TIM_OCSTATE_ENABLE;
+	pwm_output_compare.CompareValue = 0;
+	LL_TIM_OC_Init(TIMx, channel, &pwm_output_compare);
+	LL_TIM_OC_DisableFast(TIMx, channel);
+	LL_TIM_OC_EnablePreload(TIMx, channel);
+	LL_TIM_CC_EnableChannel(TIMx, channel | (channel << 2));
+}
+
+void pwm_breakEnable(TIM_TypeDef *TIMx, uint8_t PWM_BREAKx, uint32_t PWM_BREAK_SRC_x, uint8_t PWM_BREAK_ACTIVE_x, pin_t pin)
+{
+	uint32_t input = (PWM_BREAKx == PWM_BREAK2) ? LL_TIM_BREAK_INPUT_BKIN2 : LL_TIM_BREAK_INPUT_BKIN;
+
+	if (PWM_BREAK_SRC_x & PWM_BREAK_SRC_PIN)
+	{
+		pwm_pinAF(pin, TIMx, (PWM_BREAKx == PWM_BREAK2) ? PWM_PIN_BKIN2 : PWM_PIN_BKIN);
+		LL_TIM_SetBreakInputSourcePolarity(TIMx, input, LL_TIM_BKIN_SOURCE_BKIN,
+																			 (PWM_BREAK_ACTIVE_x == PWM_BREAK_ACTIVE_LOW) ? LL_TIM_BKIN_POLARITY_LOW : LL_TIM_BKIN_POLARITY_HIGH);
+	}
+	LL_TIM_EnableBreakInputSource(TIMx, input, PWM_BREAK_SRC_x);
+
+	// The outputs stay off after a fault until pwm_breakResume()
+	LL_TIM_DisableAutomaticOutput(TIMx);
+	if (PWM_BREAKx == PWM_BREAK2)
+	{
+		LL_TIM_ConfigBRK2(TIMx, LL_TIM_BREAK2_POLARITY_HIGH, LL_TIM_BREAK2_FILTER_FDIV1, LL_TIM_BREAK2_AFMODE_INPUT);
+		LL_TIM_EnableBRK2(TIMx);
+	}
+	else
+	{
+		LL_TIM_ConfigBRK(TIMx, LL_TIM_BREAK_POLARITY_HIGH, LL_TIM_BREAK_FILTER_FDIV1, LL_TIM_BREAK_AFMODE_INPUT);
+		LL_TIM_EnableBRK(TIMx);
+	}
+	LL_TIM_ClearFlag_BRK(TIMx);
+	LL_TIM_ClearFlag_BRK2(TIMx);
+	LL_TIM_EnableAllOutputs(TIMx);
+}
+
+bool pwm_breakResume(TIM_TypeDef *TIMx)
+{
+	LL_TIM_ClearFlag_BRK(TIMx);
+	LL_TIM_ClearFlag_BRK2(TIMx);
+	LL_TIM_EnableAllOutputs(TIMx);
+	// MOE is cleared again by hardware if the fault is still present
+	return LL_TIM_IsEnabledAllOutputs(TIMx) == 1;
+}
+
+void pwm_commutationInit(TIM_TypeDef *TIMx, bool on_trigger)
+{
+	LL_TIM_CC_EnablePreload(TIMx);
+	LL_TIM_CC_SetUpdate(TIMx, on_trigger ? LL_TIM_CCUPDATESOURCE_COMG_AND_TRGI : LL_TIM_CCUPDATESOURCE_COMG_ONLY);
+}
+
+void pwm_commutationStep(TIM_TypeDef *TIMx, uint32_t channel, uint8_t PWM_STEP_x)
+{
+	// Preloaded, applied by the next COM event
+	if (PWM_STEP_x == PWM_STEP_OFF)
+	{
+		LL_TIM_CC_DisableChannel(TIMx, channel | (channel << 2));
+		return;
+	}
+	LL_TIM_OC_SetMode(TIMx, channel, (PWM_STEP_x == PWM_STEP_PWM) ? LL_TIM_OCMODE_PWM1 : LL_TIM_OCMODE_FORCED_INACTIVE);
+	LL_TIM_CC_EnableChannel(TIMx, channel | (channel << 2));
+}
+
+void pwm_commutate(TIM_TypeDef *TIMx)
+{
+	LL_TIM_GenerateEvent_COM(TIMx);
 }
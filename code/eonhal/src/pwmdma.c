@@ -0,0 +1,337 @@
+/**
+  ******************************************************************************
+  * @file    pwmdma.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   PWM DMA Burst Functions
+  ******************************************************************************
+*/
+
+#include <stddef.h>
+#include "pwmdma.h"
+#include "tim.h"
+#include "pinmap_impl.h"
+#include "System.h"
+#include "stm32g0xx_ll_bus.h"
+#include "stm32g0xx_ll_dma.h"
+#include "stm32g0xx_ll_dmamux.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+/*------ DMA channel ------*/
+#if defined(USE_PWMDMA_CH2)
+#define PWMDMA_CH LL_DMA_CHANNEL_2
+#define PWMDMA_FLAG_HT DMA_ISR_HTIF2
+#define PWMDMA_FLAG_TC DMA_ISR_TCIF2
+#define PWMDMA_CLEAR_FLAGS DMA_IFCR_CGIF2
+#define PWMDMA_IRQn DMA1_Channel2_3_IRQn
+#define PWMDMA_IRQHandler DMA1_Channel2_3_IRQHandler
+#elif defined(USE_PWMDMA_CH3)
+#define PWMDMA_CH LL_DMA_CHANNEL_3
+#define PWMDMA_FLAG_HT DMA_ISR_HTIF3
+#define PWMDMA_FLAG_TC DMA_ISR_TCIF3
+#define PWMDMA_CLEAR_FLAGS DMA_IFCR_CGIF3
+#define PWMDMA_IRQn DMA1_Channel2_3_IRQn
+#define PWMDMA_IRQHandler DMA1_Channel2_3_IRQHandler
+#else
+#define PWMDMA_CH LL_DMA_CHANNEL_1
+#define PWMDMA_FLAG_HT DMA_ISR_HTIF1
+#define PWMDMA_FLAG_TC DMA_ISR_TCIF1
+#define PWMDMA_CLEAR_FLAGS DMA_IFCR_CGIF1
+#define PWMDMA_IRQn DMA1_Channel1_IRQn
+#define PWMDMA_IRQHandler DMA1_Channel1_IRQHandler
+#endif
+
+/*------ NVIC Priority ------*/
+#ifndef PWMDMA_PRIORITY
+#define PWMDMA_PRIORITY 0x01
+#endif
+
+// Transfer states
+#define PWMDMA_IDLE 0
+#define PWMDMA_SEQUENCE 1 // single sequence, a zero is sent after it
+#define PWMDMA_TAIL 2     // zero after the sequence
+#define PWMDMA_REPEAT 3   // circular sequence
+#define PWMDMA_STREAM 4   // circular buffer refilled by halves
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static pwm_channel_t _ch;
+static volatile uint8_t _state = PWMDMA_IDLE;
+static const uint16_t _zero = 0;
+
+// Stream
+static uint16_t *_buffer;
+static uint16_t _half;
+static pwmdmaFill_t _fill;
+static void *_ctx;
+static bool _ended;
+static bool _zeroHalf[2];
+
+// WS2812 encoder
+static uint16_t _ws_buffer[2 * PWMDMA_LEDS_PER_HALF * 32];
+static const uint8_t *_ws_colors;
+static uint32_t _ws_pos;
+static uint32_t _ws_len;
+static uint16_t _ws_t0h;
+static uint16_t _ws_t1h;
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+static uint32_t _dmaRequest(TIM_TypeDef *TIMx)
+{
+#if defined(TIM1)
+	if (TIMx == TIM1)
+		return LL_DMAMUX_REQ_TIM1_UP;
+#endif
+#if defined(TIM2)
+	if (TIMx == TIM2)
+		return LL_DMAMUX_REQ_TIM2_UP;
+#endif
+#if defined(TIM15)
+	if (TIMx == TIM15)
+		return LL_DMAMUX_REQ_TIM15_UP;
+#endif
+#if defined(TIM16)
+	if (TIMx == TIM16)
+		return LL_DMAMUX_REQ_TIM16_UP;
+#endif
+#if defined(TIM17)
+	if (TIMx == TIM17)
+		return LL_DMAMUX_REQ_TIM17_UP;
+#endif
+#if defined(TIM3)
+	if (TIMx == TIM3)
+		return LL_DMAMUX_REQ_TIM3_UP;
+#endif
+	return 0; // TIM14 has no DMA request
+}
+
+static void _start(const uint16_t *values, uint16_t length, uint32_t mode)
+{
+	LL_DMA_DisableChannel(DMA1, PWMDMA_CH);
+	DMA1->IFCR = PWMDMA_CLEAR_FLAGS;
+	LL_DMA_SetMode(DMA1, PWMDMA_CH, mode);
+	LL_DMA_SetMemoryAddress(DMA1, PWMDMA_CH, (uint32_t)values);
+	LL_DMA_SetDataLength(DMA1, PWMDMA_CH, length);
+
+	// Only the stream refills halves, a repeated sequence needs no interrupt
+	if (_state == PWMDMA_STREAM)
+		LL_DMA_EnableIT_HT(DMA1, PWMDMA_CH);
+	else
+		LL_DMA_DisableIT_HT(DMA1, PWMDMA_CH);
+	if (_state == PWMDMA_REPEAT)
+		LL_DMA_DisableIT_TC(DMA1, PWMDMA_CH);
+	else
+		LL_DMA_EnableIT_TC(DMA1, PWMDMA_CH);
+	power_require(POWER_USER_PWMDMA, POWER_MODE_SLEEP);
+	LL_DMA_EnableChannel(DMA1, PWMDMA_CH);
+}
+
+static void _finish(void)
+{
+	LL_DMA_DisableChannel(DMA1, PWMDMA_CH);
+	LL_TIM_DisableDMAReq_UPDATE(_ch.TIMx);
+	pwm_set(&_ch, 0);
+	_state = PWMDMA_IDLE;
+	power_release(POWER_USER_PWMDMA);
+}
+
+static void _fillHalf(uint8_t half)
+{
+	uint16_t *dst = &_buffer[half * _half];
+	uint16_t n = 0;
+
+	if (!_ended)
+		n = _fill(dst, _half, _ctx);
+	_zeroHalf[half] = (n == 0);
+	if (n < _half)
+	{
+		_ended = true;
+		while (n < _half)
+			dst[n++] = 0;
+	}
+}
+
+// A half was sent, it's refilled while the other one is being sent
+static void _halfSent(uint8_t half)
+{
+	if (_zeroHalf[half])
+	{
+		// Data and a full half of zeros (reset time) were sent
+		_finish();
+		return;
+	}
+	_fillHalf(half);
+}
+
+static uint16_t _ws2812Fill(uint16_t *dst, uint16_t count, void *ctx)
+{
+	uint16_t n = 0;
+	uint8_t b, bit;
+
+	(void)ctx;
+	while ((n < count) && (_ws_pos < _ws_len))
+	{
+		b = _ws_colors[_ws_pos++];
+		for (bit = 0; bit < 8; bit++)
+		{
+			dst[n++] = (b & 0x80) ? _ws_t1h : _ws_t0h;
+			b <<= 1;
+		}
+	}
+	return n;
+}
+
+/**
+ ===============================================================================
+              ##### Interrupt #####
+ ===============================================================================
+ */
+
+void PWMDMA_IRQHandler(void)
+{
+	uint32_t flags = DMA1->ISR & (PWMDMA_FLAG_HT | PWMDMA_FLAG_TC);
+
+	if (flags == 0)
+		return;
+	DMA1->IFCR = PWMDMA_CLEAR_FLAGS;
+
+	if (_state == PWMDMA_STREAM)
+	{
+		if (flags & PWMDMA_FLAG_HT)
+			_halfSent(0);
+		if ((flags & PWMDMA_FLAG_TC) && _state == PWMDMA_STREAM)
+			_halfSent(1);
+	}
+	else if (_state == PWMDMA_SEQUENCE && (flags & PWMDMA_FLAG_TC))
+	{
+		// The last value is output in the next period, a zero is queued after it
+		_state = PWMDMA_TAIL;
+		_start(&_zero, 1, LL_DMA_MODE_NORMAL);
+	}
+	else if (_state == PWMDMA_TAIL && (flags & PWMDMA_FLAG_TC))
+	{
+		_finish();
+	}
+}
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+bool pwmdma_init(pin_t pin)
+{
+	uint32_t request = _dmaRequest(HAL_Pin_Map()[pin].TIMx);
+
+	pwmdma_stop();
+	if (request == 0)
+	{
+		_ch.TIMx = NULL;
+		return false;
+	}
+	pwm_channelInit(&_ch, pin);
+
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA1);
+	LL_DMA_DisableChannel(DMA1, PWMDMA_CH);
+	LL_DMA_ConfigTransfer(DMA1, PWMDMA_CH,
+												LL_DMA_DIRECTION_MEMORY_TO_PERIPH | LL_DMA_MODE_NORMAL |
+														LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT |
+														LL_DMA_PDATAALIGN_WORD | LL_DMA_MDATAALIGN_HALFWORD |
+														LL_DMA_PRIORITY_HIGH);
+	LL_DMA_SetPeriphAddress(DMA1, PWMDMA_CH, (uint32_t)_ch.ccr);
+	LL_DMA_SetPeriphRequest(DMA1, PWMDMA_CH, request);
+
+	NVIC_SetPriority(PWMDMA_IRQn, PWMDMA_PRIORITY);
+	NVIC_EnableIRQ(PWMDMA_IRQn);
+	return true;
+}
+
+void pwmdma_write(const uint16_t *values, uint16_t length, bool repeat)
+{
+	pwmdma_stop();
+	if (_ch.TIMx == NULL || length == 0)
+		return;
+	_state = repeat ? PWMDMA_REPEAT : PWMDMA_SEQUENCE;
+	_start(values, length, repeat ? LL_DMA_MODE_CIRCULAR : LL_DMA_MODE_NORMAL);
+	LL_TIM_EnableDMAReq_UPDATE(_ch.TIMx);
+}
+
+void pwmdma_stream(uint16_t *buffer, uint16_t length, pwmdmaFill_t fill, void *ctx)
+{
+	pwmdma_stop();
+	if (_ch.TIMx == NULL)
+		return;
+	_buffer = buffer;
+	_half = length / 2;
+	_fill = fill;
+	_ctx = ctx;
+	_ended = false;
+	_zeroHalf[0] = false;
+	_zeroHalf[1] = false;
+	_fillHalf(0);
+	_fillHalf(1);
+	if (_zeroHalf[0])
+		return; // nothing to send
+
+	_state = PWMDMA_STREAM;
+	_start(buffer, _half * 2, LL_DMA_MODE_CIRCULAR);
+	LL_TIM_EnableDMAReq_UPDATE(_ch.TIMx);
+}
+
+void pwmdma_stop(void)
+{
+	if (_ch.TIMx == NULL)
+		return;
+	_finish();
+}
+
+bool pwmdma_isBusy(void)
+{
+	return _state != PWMDMA_IDLE;
+}
+
+bool pwmdma_ws2812Init(pin_t pin)
+{
+	TIM_TypeDef *TIMx = HAL_Pin_Map()[pin].TIMx;
+	uint32_t counts = tim_getSrcClk(TIMx) / 800000; // 1.25 us bit
+
+	if (_dmaRequest(TIMx) == 0)
+		return false;
+	pwm_init(TIMx, 1, counts);
+	pwm_pinEnable(pin);
+	if (!pwmdma_init(pin))
+		return false;
+
+	// 0: 0.4 us high, 1: 0.8 us high (inside WS2812 and SK6812 tolerances)
+	_ws_t0h = (counts * 8) / 25;
+	_ws_t1h = (counts * 16) / 25;
+	return true;
+}
+
+bool pwmdma_ws2812Write(const uint8_t *colors, uint16_t leds, uint8_t bytes_per_led)
+{
+	// _ws_buffer holds up to 4 bytes (32 bits) per led
+	if (bytes_per_led == 0 || bytes_per_led > 4)
+		return false;
+	_ws_colors = colors;
+	_ws_pos = 0;
+	_ws_len = (uint32_t)leds * bytes_per_led;
+	pwmdma_stream(_ws_buffer, 2 * PWMDMA_LEDS_PER_HALF * bytes_per_led * 8, _ws2812Fill, NULL);
+	return true;
+}
@@ -0,0 +1,266 @@
+/**
+  ******************************************************************************
+  * @file    rtcsched.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   RTC Job Scheduler Functions
+  ******************************************************************************
+*/
+
+#include <stddef.h>
+#include "System.h"
+#include "rtcsched.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+// Job types
+#define JOB_ONCE 0
+#define JOB_PERIODIC 1
+#define JOB_CRON 2
+
+#define SECONDS_PER_DAY 86400
+#define SECONDS_PER_HOUR 3600
+#define ALARM_MAX_AHEAD (SECONDS_PER_DAY - 1) // the alarm matches the time of the day
+
+// Steps of rtcsched_cronNext(), 4 years of days (Feb 29) plus hour steps
+#define CRON_MAX_STEPS 2000
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static rtcjob_t *_queue; // sorted by time
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+static void _unlink(rtcjob_t *job)
+{
+	rtcjob_t **p = &_queue;
+
+	while (*p != NULL && *p != job)
+		p = &(*p)->next;
+	if (*p != NULL)
+		*p = job->next;
+	job->next = NULL;
+}
+
+static void _insert(rtcjob_t *job)
+{
+	rtcjob_t **p = &_queue;
+
+	// After the jobs of the same time, so they run in order
+	while (*p != NULL && (int32_t)((*p)->time - job->time) <= 0)
+		p = &(*p)->next;
+	job->next = *p;
+	*p = job;
+}
+
+// Alarm A for the first job, a job already due runs in the next second
+static void _program(void)
+{
+	uint32_t now, ahead;
+
+	if (_queue == NULL)
+	{
+		rtc_setAlarmAAfter(0);
+		return;
+	}
+	now = rtc_getUnix();
+	ahead = ((int32_t)(_queue->time - now) > 0) ? _queue->time - now : 1;
+	if (ahead > ALARM_MAX_AHEAD)
+		ahead = ALARM_MAX_AHEAD;
+	rtc_setAlarmAAfter(ahead);
+}
+
+static void _schedule(rtcjob_t *job, uint8_t type, uint32_t time, rtcjobCallback_t callback, void *ctx)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	_unlink(job);
+	job->type = type;
+	job->time = time;
+	job->callback = callback;
+	job->ctx = ctx;
+	_insert(job);
+	if (_queue == job)
+		_program();
+	__set_PRIMASK(primask);
+}
+
+static uint8_t _nextBit(uint64_t mask, uint8_t from, uint8_t limit)
+{
+	while (from < limit && (mask & (1ULL << from)) == 0)
+		from++;
+	return from;
+}
+
+/**
+ ===============================================================================
+              ##### Interrupt #####
+ ===============================================================================
+ */
+
+void __Handler_RTC_ALARMA(void)
+{
+	uint32_t now = rtc_getUnix();
+	rtcjob_t *job;
+
+	while (_queue != NULL && (int32_t)(_queue->time - now) <= 0)
+	{
+		job = _queue;
+		_queue = job->next;
+		job->next = NULL;
+
+		if (job->type == JOB_PERIODIC)
+		{
+			job->time += job->period;
+			if ((int32_t)(job->time - now) <= 0)
+				job->time = now + job->period; // missed periods run once
+			_insert(job);
+		}
+		else if (job->type == JOB_CRON)
+		{
+			job->time = rtcsched_cronNext(&job->cron, now);
+			if (job->time != 0)
+				_insert(job);
+		}
+		// The callback can cancel or schedule jobs
+		job->callback(job->ctx);
+	}
+	_program();
+}
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+void rtcsched_at(rtcjob_t *job, uint32_t unix, rtcjobCallback_t callback, void *ctx)
+{
+	_schedule(job, JOB_ONCE, unix, callback, ctx);
+}
+
+void rtcsched_every(rtcjob_t *job, uint32_t seconds, rtcjobCallback_t callback, void *ctx)
+{
+	job->period = (seconds != 0) ? seconds : 1;
+	_schedule(job, JOB_PERIODIC, rtc_getUnix() + job->period, callback, ctx);
+}
+
+bool rtcsched_cron(rtcjob_t *job, const rtccron_t *cron, rtcjobCallback_t callback, void *ctx)
+{
+	uint32_t time = rtcsched_cronNext(cron, rtc_getUnix());
+
+	if (time == 0)
+	{
+		rtcsched_cancel(job);
+		return false;
+	}
+	job->cron = *cron;
+	_schedule(job, JOB_CRON, time, callback, ctx);
+	return true;
+}
+
+void rtcsched_cancel(rtcjob_t *job)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (_queue == job)
+	{
+		_unlink(job);
+		_program();
+	}
+	else
+	{
+		_unlink(job);
+	}
+	__set_PRIMASK(primask);
+}
+
+bool rtcsched_isActive(rtcjob_t *job)
+{
+	rtcjob_t *p = _queue;
+
+	while (p != NULL && p != job)
+		p = p->next;
+	return p != NULL;
+}
+
+uint32_t rtcsched_next(void)
+{
+	rtcjob_t *first = _queue;
+	return (first != NULL) ? first->time : 0;
+}
+
+void rtcsched_reschedule(void)
+{
+	uint32_t now, primask;
+	rtcjob_t *list, *job;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	now = rtc_getUnix();
+	list = _queue;
+	_queue = NULL;
+	while (list != NULL)
+	{
+		job = list;
+		list = job->next;
+		job->next = NULL;
+		if (job->type == JOB_CRON)
+		{
+			job->time = rtcsched_cronNext(&job->cron, now);
+			if (job->time == 0)
+				continue;
+		}
+		_insert(job);
+	}
+	_program();
+	__set_PRIMASK(primask);
+}
+
+uint32_t rtcsched_cronNext(const rtccron_t *cron, uint32_t unix)
+{
+	LocalTime_t t;
+	uint32_t time = unix - (unix % 60) + 60; // next minute
+	uint16_t steps;
+	uint8_t minute;
+
+	for (steps = 0; steps < CRON_MAX_STEPS; steps++)
+	{
+		unix2time(time, &t);
+		if ((cron->months & (1U << t.month)) == 0)
+		{
+			// First day of the next month
+			time = (t.month == 12) ? date2days(2001 + t.year, 1, 1) : date2days(2000 + t.year, t.month + 1, 1);
+			time *= SECONDS_PER_DAY;
+		}
+		else if ((cron->days & (1UL << t.day)) == 0 || (cron->weekdays & (1U << t.weekday)) == 0)
+		{
+			time = ((time / SECONDS_PER_DAY) + 1) * SECONDS_PER_DAY;
+		}
+		else if ((cron->hours & (1UL << t.hours)) == 0)
+		{
+			time = time - (time % SECONDS_PER_HOUR) + SECONDS_PER_HOUR;
+		}
+		else
+		{
+			minute = _nextBit(cron->minutes, t.minutes, 60);
+			if (minute < 60)
+				return time + ((minute - t.minutes) * 60);
+			time = time - (time % SECONDS_PER_HOUR) + SECONDS_PER_HOUR;
+		}
+	}
+	return 0;
+}
@@ -10,6 +10,7 @@
 
 #include "spi.h"
 #include "gpio.h"
+#include "System.h"
 #include "stm32g0xx_ll_rcc.h"
 #include "stm32g0xx_ll_bus.h"
 #include "stm32g0xx_ll_spi.h"
@@ -411,6 +412,27 @@ void SPISlave_init(SPI_TypeDef *SPIx, pin_t sck, pin_t miso, pin_t mosi, pin_t s
 	NVIC_SetPriority(irq, 0);
 	NVIC_EnableIRQ(irq);
 	LL_SPI_EnableIT_RXNE(SPIx);
+
+	// The slave receives in the interrupt, PCLK is needed
+	power_require((SPIx == SPI1) ? POWER_USER_SPI1 : POWER_USER_SPI2, POWER_MODE_SLEEP);
+}
+
+void SPISlave_off(SPI_TypeDef *SPIx)
+{
+	LL_SPI_DisableIT_RXNE(SPIx);
+	LL_SPI_Disable(SPIx);
+	if (SPIx == SPI1)
+	{
+		NVIC_DisableIRQ(SPI1_IRQn);
+		power_release(POWER_USER_SPI1);
+	}
+#if defined(SPI2)
+	if (SPIx == SPI2)
+	{
+		NVIC_DisableIRQ(SPI2_IRQn);
+		power_release(POWER_USER_SPI2);
+	}
+#endif
 }
 
 void SPI1_IRQHandler(void)
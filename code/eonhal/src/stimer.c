@@ -0,0 +1,471 @@
+/**
+  ******************************************************************************
+  * @file    stimer.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   Software Timers Functions
+  ******************************************************************************
+*/
+
+#include "stimer.h"
+#include "System.h"
+#include "tim.h"
+#include "eon_math.h"
+#include "stm32g0xx_ll_bus.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+/*------ Hardware timer ------*/
+#if defined(USE_TICKLESS)
+// The tickless timebase (LPTIM) is used, no hardware timer is needed
+#elif defined(USE_STIMER_TIM3)
+#define STIMER_TIM TIM3
+#define STIMER_IRQHandler TIM3_IRQHandler
+#elif defined(USE_STIMER_TIM15) && defined(TIM15)
+#define STIMER_TIM TIM15
+#define STIMER_IRQHandler TIM15_IRQHandler
+#elif defined(USE_STIMER_TIM16)
+#define STIMER_TIM TIM16
+#define STIMER_IRQHandler TIM16_IRQHandler
+#elif defined(USE_STIMER_TIM17)
+#define STIMER_TIM TIM17
+#define STIMER_IRQHandler TIM17_IRQHandler
+#else
+#define STIMER_TIM TIM14
+#define STIMER_IRQHandler TIM14_IRQHandler
+#endif
+
+/*------ NVIC Priority ------*/
+#ifndef STIMER_PRIORITY
+#define STIMER_PRIORITY 0x01
+#endif
+
+// Timer wheel: 4 levels of 32 slots cover 2^20 ms (~17 min), farther
+// timers wait in the overflow list
+#define STIMER_LEVELS 4
+#define STIMER_SLOT_BITS 5
+#define STIMER_SLOTS (1UL << STIMER_SLOT_BITS)
+#define STIMER_SLOT_MASK (STIMER_SLOTS - 1)
+#define STIMER_WHEEL_BITS (STIMER_LEVELS * STIMER_SLOT_BITS)
+
+// Lists, 0 means "not linked" so zero initialized handles are stopped
+#define STIMER_LIST_NONE 0
+#define STIMER_LIST_WHEEL(__LEVEL__, __SLOT__) (1 + ((__LEVEL__)*STIMER_SLOTS) + (__SLOT__))
+#define STIMER_LIST_OVERFLOW (1 + (STIMER_LEVELS * STIMER_SLOTS))
+#define STIMER_TOTAL_LISTS (STIMER_LIST_OVERFLOW + 1)
+
+// Deferred state flags
+#define STIMER_FLAG_QUEUED 0x01 // linked in the ready queue
+#define STIMER_FLAG_FIRED 0x02 // callback must be executed by stimer_run()
+
+// The hardware counter is 16 bits, farther compares are split so the
+// extended timebase never misses a counter overflow
+#define STIMER_HW_MAX_DELTA 0x8000UL
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static stimer_t *_lists[STIMER_TOTAL_LISTS];
+static uint32_t _occupied[STIMER_LEVELS]; // one bit per non empty slot
+static uint32_t _wheel_now; // time up to which the wheel has been processed
+#if !defined(USE_TICKLESS)
+static uint32_t _hw_now; // 32 bits extension of the hardware counter
+#endif
+static stimer_t *_ready_head;
+static stimer_t *_ready_tail;
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+// These functions must be called with interrupts disabled
+
+static uint32_t _hw_read(void)
+{
+#if defined(USE_TICKLESS)
+	return millis();
+#else
+	uint16_t cnt = (uint16_t)LL_TIM_GetCounter(STIMER_TIM);
+	_hw_now += (uint16_t)(cnt - (uint16_t)_hw_now);
+	return _hw_now;
+#endif
+}
+
+static void _link(stimer_t *t, uint8_t list)
+{
+	t->list = list;
+	t->prev = NULL;
+	t->next = _lists[list];
+	if (t->next != NULL)
+		t->next->prev = t;
+	_lists[list] = t;
+	if (list != STIMER_LIST_OVERFLOW)
+		_occupied[(list - 1) >> STIMER_SLOT_BITS] |= (1UL << ((list - 1) & STIMER_SLOT_MASK));
+}
+
+static void _unlink(stimer_t *t)
+{
+	uint8_t list = t->list;
+	if (t->prev != NULL)
+		t->prev->next = t->next;
+	else
+		_lists[list] = t->next;
+	if (t->next != NULL)
+		t->next->prev = t->prev;
+	if (list != STIMER_LIST_OVERFLOW && _lists[list] == NULL)
+		_occupied[(list - 1) >> STIMER_SLOT_BITS] &= ~(1UL << ((list - 1) & STIMER_SLOT_MASK));
+	t->list = STIMER_LIST_NONE;
+}
+
+// The level is given by the highest group of bits where the deadline
+// differs from the wheel time
+static void _place(stimer_t *t)
+{
+	uint32_t diff = t->expires ^ _wheel_now;
+	uint8_t level;
+
+	for (level = 0; level < STIMER_LEVELS; level++)
+	{
+		if ((diff >> (STIMER_SLOT_BITS * (level + 1))) == 0)
+		{
+			_link(t, STIMER_LIST_WHEEL(level, (t->expires >> (STIMER_SLOT_BITS * level)) & STIMER_SLOT_MASK));
+			return;
+		}
+	}
+	_link(t, STIMER_LIST_OVERFLOW);
+}
+
+// Next time where a slot must be expired or cascaded to a lower level
+static bool _nextEvent(uint32_t *when)
+{
+	uint8_t level, shift, index;
+	uint32_t pending;
+
+	for (level = 0; level < STIMER_LEVELS; level++)
+	{
+		shift = STIMER_SLOT_BITS * level;
+		index = (_wheel_now >> shift) & STIMER_SLOT_MASK;
+		if (index == STIMER_SLOT_MASK)
+			continue;
+		pending = _occupied[level] & (0xFFFFFFFFUL << (index + 1));
+		if (pending != 0)
+		{
+			*when = (_wheel_now & ~((1UL << (shift + STIMER_SLOT_BITS)) - 1)) | ((uint32_t)lowestBitSet(pending) << shift);
+			return true;
+		}
+	}
+	if (_lists[STIMER_LIST_OVERFLOW] != NULL)
+	{
+		*when = (_wheel_now | ((1UL << STIMER_WHEEL_BITS) - 1)) + 1;
+		return true;
+	}
+	return false;
+}
+
+static void _cascade(uint8_t list)
+{
+	stimer_t *t = _lists[list];
+	stimer_t *next;
+
+	_lists[list] = NULL;
+	if (list != STIMER_LIST_OVERFLOW)
+		_occupied[(list - 1) >> STIMER_SLOT_BITS] &= ~(1UL << ((list - 1) & STIMER_SLOT_MASK));
+	while (t != NULL)
+	{
+		next = t->next;
+		_place(t);
+		t = next;
+	}
+}
+
+static void _expire(stimer_t *t)
+{
+	if (t->mode & STIMER_PERIODIC)
+	{
+		t->expires += t->period;
+		if ((int32_t)(t->expires - _wheel_now) <= 0)
+			t->expires = _wheel_now + t->period;
+		_place(t);
+	}
+
+	if (t->mode & STIMER_DEFERRED)
+	{
+		t->flags |= STIMER_FLAG_FIRED;
+		if ((t->flags & STIMER_FLAG_QUEUED) == 0)
+		{
+			t->flags |= STIMER_FLAG_QUEUED;
+			t->ready = NULL;
+			if (_ready_tail != NULL)
+				_ready_tail->ready = t;
+			else
+				_ready_head = t;
+			_ready_tail = t;
+		}
+		return;
+	}
+
+	// Callbacks run with interrupts enabled, the timer is already unlinked
+	// (or re-armed) so it may be stopped or restarted from its own callback
+	__enable_irq();
+	t->callback(t->ctx);
+	__disable_irq();
+}
+
+static void _advance(uint32_t when)
+{
+	uint8_t level, shift, list;
+	stimer_t *t;
+
+	_wheel_now = when;
+
+	// Move the timers of the slots that start now to lower levels
+	if ((when & ((1UL << STIMER_WHEEL_BITS) - 1)) == 0 && _lists[STIMER_LIST_OVERFLOW] != NULL)
+		_cascade(STIMER_LIST_OVERFLOW);
+	for (level = STIMER_LEVELS - 1; level > 0; level--)
+	{
+		shift = STIMER_SLOT_BITS * level;
+		if ((when & ((1UL << shift) - 1)) != 0)
+			continue;
+		list = STIMER_LIST_WHEEL(level, (when >> shift) & STIMER_SLOT_MASK);
+		if (_lists[list] != NULL)
+			_cascade(list);
+	}
+
+	// Expire the timers of the current slot
+	list = STIMER_LIST_WHEEL(0, when & STIMER_SLOT_MASK);
+	while ((t = _lists[list]) != NULL)
+	{
+		_unlink(t);
+		_expire(t);
+	}
+}
+
+#if defined(USE_TICKLESS)
+
+static void _program(void)
+{
+	uint32_t when;
+
+	if (_nextEvent(&when))
+		tickless_setDeadline(TICKLESS_DEADLINE_STIMER, when);
+	else
+		tickless_clearDeadline(TICKLESS_DEADLINE_STIMER);
+}
+
+#else
+
+static void _program(void)
+{
+	uint32_t when;
+	uint32_t now = _hw_read();
+	uint32_t delta = STIMER_HW_MAX_DELTA;
+
+	if (_nextEvent(&when))
+	{
+		// The timer stops in Stop mode
+		power_require(POWER_USER_STIMER, POWER_MODE_SLEEP);
+		delta = when - now;
+		if ((int32_t)delta <= 0)
+		{
+			LL_TIM_GenerateEvent_CC1(STIMER_TIM);
+			return;
+		}
+		if (delta > STIMER_HW_MAX_DELTA)
+			delta = STIMER_HW_MAX_DELTA;
+	}
+	else
+	{
+		power_release(POWER_USER_STIMER);
+	}
+
+	LL_TIM_OC_SetCompareCH1(STIMER_TIM, (uint16_t)(now + delta));
+
+	// The counter could have reached the compare value while it was written
+	if ((uint16_t)((uint16_t)LL_TIM_GetCounter(STIMER_TIM) - (uint16_t)now) >= delta)
+		LL_TIM_GenerateEvent_CC1(STIMER_TIM);
+}
+
+#endif
+
+static void _process(void)
+{
+	uint32_t now, when;
+
+	__disable_irq();
+	now = _hw_read();
+	while (_nextEvent(&when) && (int32_t)(when - now) <= 0)
+	{
+		_advance(when);
+		now = _hw_read();
+	}
+	// No events until the next one, so the wheel can jump to the current time
+	_wheel_now = now;
+	_program();
+	__enable_irq();
+}
+
+/**
+ ===============================================================================
+              ##### Interrupt #####
+ ===============================================================================
+ */
+
+#if defined(USE_TICKLESS)
+
+// Called from the LPTIM interrupt when TICKLESS_DEADLINE_STIMER expires
+void __Handler_TICKLESS_STIMER(void)
+{
+	_process();
+}
+
+#else
+
+void STIMER_IRQHandler(void)
+{
+	if (LL_TIM_IsActiveFlag_CC1(STIMER_TIM) == 0)
+		return;
+	LL_TIM_ClearFlag_CC1(STIMER_TIM);
+	_process();
+}
+
+#endif
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+void stimer_init(void)
+{
+#if defined(USE_TICKLESS)
+	uint32_t primask = __get_PRIMASK();
+
+	// The timebase is millis(), so there is nothing to configure
+	__disable_irq();
+	_program();
+	__set_PRIMASK(primask);
+#else
+	LL_TIM_InitTypeDef TIM_InitStruct;
+	uint8_t tim_irqn;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	tim_irqn = tim_clkEnableAndGetIRQn(STIMER_TIM);
+
+	// Keep the timebase when it's initialized again after a clock change
+	_hw_read();
+	LL_TIM_DisableCounter(STIMER_TIM);
+
+	TIM_InitStruct.Prescaler = (tim_getSrcClk(STIMER_TIM) / 1000) - 1;
+	TIM_InitStruct.CounterMode = LL_TIM_COUNTERMODE_UP;
+	TIM_InitStruct.Autoreload = 0xFFFF;
+	TIM_InitStruct.ClockDivision = LL_TIM_CLOCKDIVISION_DIV1;
+	TIM_InitStruct.RepetitionCounter = 0;
+	LL_TIM_Init(STIMER_TIM, &TIM_InitStruct);
+	LL_TIM_SetCounter(STIMER_TIM, (uint16_t)_hw_now);
+
+	LL_TIM_SetClockSource(STIMER_TIM, LL_TIM_CLOCKSOURCE_INTERNAL);
+	LL_TIM_OC_SetMode(STIMER_TIM, LL_TIM_CHANNEL_CH1, LL_TIM_OCMODE_FROZEN);
+	LL_TIM_ClearFlag_CC1(STIMER_TIM);
+	LL_TIM_EnableIT_CC1(STIMER_TIM);
+	LL_TIM_EnableCounter(STIMER_TIM);
+	_program();
+
+	NVIC_SetPriority((IRQn_Type)tim_irqn, STIMER_PRIORITY);
+	NVIC_EnableIRQ((IRQn_Type)tim_irqn);
+	__set_PRIMASK(primask);
+#endif
+}
+
+void stimer_start(stimer_t *t, uint32_t ms, uint8_t mode, stimerCallback_t callback, void *ctx)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	if (ms == 0)
+		ms = 1;
+
+	__disable_irq();
+	if (t->list != STIMER_LIST_NONE)
+		_unlink(t);
+	t->flags &= ~STIMER_FLAG_FIRED;
+	t->callback = callback;
+	t->ctx = ctx;
+	t->mode = mode;
+	t->period = ms;
+	t->expires = _hw_read() + ms;
+	_place(t);
+	_program();
+	__set_PRIMASK(primask);
+}
+
+void stimer_stop(stimer_t *t)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (t->list != STIMER_LIST_NONE)
+		_unlink(t);
+	t->flags &= ~STIMER_FLAG_FIRED;
+	__set_PRIMASK(primask);
+}
+
+bool stimer_isActive(stimer_t *t)
+{
+	return (t->list != STIMER_LIST_NONE) || ((t->flags & STIMER_FLAG_FIRED) != 0);
+}
+
+uint16_t stimer_run(void)
+{
+	uint16_t count = 0;
+	uint8_t fired;
+	stimer_t *t;
+	uint32_t primask;
+
+	while (1)
+	{
+		primask = __get_PRIMASK();
+		__disable_irq();
+		t = _ready_head;
+		if (t == NULL)
+		{
+			__set_PRIMASK(primask);
+			break;
+		}
+		_ready_head = t->ready;
+		if (_ready_head == NULL)
+			_ready_tail = NULL;
+		fired = t->flags & STIMER_FLAG_FIRED;
+		t->flags &= ~(STIMER_FLAG_QUEUED | STIMER_FLAG_FIRED);
+		__set_PRIMASK(primask);
+
+		// A stopped timer stays queued, but it's not executed
+		if (fired)
+		{
+			t->callback(t->ctx);
+			count++;
+		}
+	}
+	return count;
+}
+
+uint32_t stimer_now(void)
+{
+	uint32_t now;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	now = _hw_read();
+	__set_PRIMASK(primask);
+	return now;
+}
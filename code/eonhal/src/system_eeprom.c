@@ -9,6 +9,8 @@
 */
 
 #include "System.h"
+#include "stm32g0xx_ll_crc.h"
+#include "eon_math.h"
 
 /** 
  ===============================================================================
@@ -16,61 +18,29 @@
  ===============================================================================
  */
 
-// FLASH Timeout
-#define FLASH_TIMEOUT_VALUE (50000U) // 50 s
-#define FLASH_PAGE_SIZE	0x800u
-
-#define DATA_EEPROM_SIZE 	512 // in bytes
+#define DATA_EEPROM_SIZE 	VEEPROM_SIZE // in bytes
+#define DATA_EEPROM_WORDS (DATA_EEPROM_SIZE / 4)
 #define DATA_EEPROM_END		(uint32_t)((FLASH_BASE) + (LL_GetFlashSize()*1024) - 1)
-#define DATA_EEPROM_BASE	(uint32_t)((DATA_EEPROM_END) - FLASH_PAGE_SIZE + 1)
-#define DATA_EEPROM_LIMIT (uint32_t)((DATA_EEPROM_BASE) + DATA_EEPROM_SIZE)
-
-#define FLASH_TYPEPROGRAM_DOUBLEWORD    FLASH_CR_PG     /*!< Program a double-word (64-bit) at a specified address */
-#define FLASH_TYPEPROGRAM_FAST          FLASH_CR_FSTPG  /*!< Fast program a 32 row double-word (64-bit) at a specified address */
-
-#define FLASH_KEY1 0x45670123U /*!< Flash key1 */
-#define FLASH_KEY2 0xCDEF89ABU /*!< Flash key2: used with FLASH_KEY1 \ \
-																		to unlock the FLASH registers access */
-
-#define FLASH_FLAG_EOP                  FLASH_SR_EOP      /*!< FLASH End of operation flag */
-#define FLASH_FLAG_OPERR                FLASH_SR_OPERR    /*!< FLASH Operation error flag */
-#define FLASH_FLAG_PROGERR              FLASH_SR_PROGERR  /*!< FLASH Programming error flag */
-#define FLASH_FLAG_WRPERR               FLASH_SR_WRPERR   /*!< FLASH Write protection error flag */
-#define FLASH_FLAG_PGAERR               FLASH_SR_PGAERR   /*!< FLASH Programming alignment error flag */
-#define FLASH_FLAG_SIZERR               FLASH_SR_SIZERR   /*!< FLASH Size error flag  */
-#define FLASH_FLAG_PGSERR               FLASH_SR_PGSERR   /*!< FLASH Programming sequence error flag */
-#define FLASH_FLAG_MISERR               FLASH_SR_MISERR   /*!< FLASH Fast programming data miss error flag */
-#define FLASH_FLAG_FASTERR              FLASH_SR_FASTERR  /*!< FLASH Fast programming error flag */
-#if defined(FLASH_PCROP_SUPPORT)
-#define FLASH_FLAG_RDERR                FLASH_SR_RDERR    /*!< FLASH PCROP read error flag */
-#endif /* FLASH_PCROP_SUPPORT */
-#define FLASH_FLAG_OPTVERR              FLASH_SR_OPTVERR  /*!< FLASH Option validity error flag */
-#define FLASH_FLAG_BSY                  FLASH_SR_BSY1     /*!< FLASH Operation Busy flag */
-#define FLASH_FLAG_CFGBSY               FLASH_SR_CFGBSY   /*!< FLASH Configuration Busy flag */
-#define FLASH_FLAG_ECCC                 FLASH_ECCR_ECCC   /*!< FLASH ECC correction */
-#define FLASH_FLAG_ECCD                 FLASH_ECCR_ECCD   /*!< FLASH ECC detection */
-#if defined(FLASH_PCROP_SUPPORT)
-#define FLASH_FLAG_SR_ERROR             (FLASH_FLAG_OPERR  | FLASH_FLAG_PROGERR | FLASH_FLAG_WRPERR |  \
-                                         FLASH_FLAG_PGAERR | FLASH_FLAG_SIZERR  | FLASH_FLAG_PGSERR |   \
-                                         FLASH_FLAG_MISERR | FLASH_FLAG_FASTERR | FLASH_FLAG_RDERR |   \
-                                         FLASH_FLAG_OPTVERR)     /*!< All SR error flags */
-#else
-#define FLASH_FLAG_SR_ERROR             (FLASH_FLAG_OPERR  | FLASH_FLAG_PROGERR | FLASH_FLAG_WRPERR |  \
-                                         FLASH_FLAG_PGAERR | FLASH_FLAG_SIZERR  | FLASH_FLAG_PGSERR |   \
-                                         FLASH_FLAG_MISERR | FLASH_FLAG_FASTERR |   \
-                                         FLASH_FLAG_OPTVERR)     /*!< All SR error flags */
+#define DATA_EEPROM_BASE	(uint32_t)((DATA_EEPROM_END) - FLASH_PAGE_SIZE + 1) // page of the old (not logged) format
+
+#if (VEEPROM_SIZE % 8) != 0 || VEEPROM_SIZE > 1016
+#error "VEEPROM_SIZE must be a multiple of 8, up to 1016 bytes"
 #endif
-#define FLASH_FLAG_BSY                  FLASH_SR_BSY1     /*!< FLASH Operation Busy flag */
-#define FLASH_FLAG_CFGBSY               FLASH_SR_CFGBSY   /*!< FLASH Configuration Busy flag */
-#define FLASH_FLAG_ECCC                 FLASH_ECCR_ECCC   /*!< FLASH ECC correction */
-#define FLASH_FLAG_ECCD                 FLASH_ECCR_ECCD   /*!< FLASH ECC detection */
-
-#define __HAL_FLASH_GET_FLAG(__FLAG__)          ((((__FLAG__) & (FLASH_FLAG_ECCC | FLASH_FLAG_ECCD)) != 0U) ? \
-                                                 (READ_BIT(FLASH->ECCR, (__FLAG__)) == (__FLAG__))  : \
-                                                 (READ_BIT(FLASH->SR,   (__FLAG__)) == (__FLAG__)))
-#define __HAL_FLASH_CLEAR_FLAG(__FLAG__)        do { if(((__FLAG__) & (FLASH_FLAG_ECCC | FLASH_FLAG_ECCD)) != 0U) { SET_BIT(FLASH->ECCR, ((__FLAG__) & (FLASH_FLAG_ECCC | FLASH_FLAG_ECCD))); }\
-                                                     if(((__FLAG__) & ~(FLASH_FLAG_ECCC | FLASH_FLAG_ECCD)) != 0U) { WRITE_REG(FLASH->SR, ((__FLAG__) & ~(FLASH_FLAG_ECCC | FLASH_FLAG_ECCD))); }\
-                                                   } while(0U)
+#if VEEPROM_PAGES < 2
+#error "VEEPROM_PAGES must be 2 or more"
+#endif
+
+// Log pages: the last VEEPROM_PAGES pages of the flash, made of double-word slots
+#define VEEPROM_FIRST_PAGE (flash_getPages() - VEEPROM_PAGES)
+#define VEEPROM_PAGE_ADDR(__N__) flash_getPageAddress(VEEPROM_FIRST_PAGE + (__N__))
+#define VEEPROM_SLOTS (FLASH_PAGE_SIZE / 8)
+#define VEEPROM_SLOT_HEADER 0	 // {sequence | records << 16, CRC}, written after the page is complete
+#define VEEPROM_SLOT_OBSOLETE 1 // programmed when a newer page is complete
+#define VEEPROM_FIRST_RECORD 2
+#define VEEPROM_BLANK 0xFFFFFFFFFFFFFFFFULL
+
+// Record: {index | check << 16, value} of a changed word
+#define VEEPROM_RECORD(__INDEX__, __VALUE__) ((uint64_t)(__VALUE__) << 32 | ((uint32_t)_eeprom_check(__INDEX__, __VALUE__) << 16) | (__INDEX__))
 
 /** 
  ===============================================================================
@@ -79,11 +49,11 @@
  */
 
 static uint8_t _eedata[DATA_EEPROM_SIZE];
+static uint32_t _dirty[(DATA_EEPROM_WORDS + 31) / 32]; // words changed since the last commit
 
-typedef union{
-	uint8_t u8[8];
-	uint64_t u64;
-}eedata_t;
+static uint8_t _page;	 // active log page
+static uint16_t _slot; // next free slot of the active page, 0 if there's no active page
+static uint16_t _seq;	 // sequence of the active page
 
 /** 
  ===============================================================================
@@ -91,92 +61,123 @@ typedef union{
  ===============================================================================
  */
 
-static uint8_t _waitForLastOperation(uint32_t timeout)
+static uint8_t _eeprom_erasePage(uint8_t n)
 {
-	uint32_t error;
-	uint32_t exit_time = millis() + timeout;
-	
-	while (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) != 0x00U)
-	{ 
-		if (millis() >= exit_time)
-			return 0;
-	}
-
-	/* check flash errors. Only ECC correction can be checked here as ECCD
-      generates NMI */
-  error = (FLASH->SR & FLASH_FLAG_SR_ERROR);
-  error |= (FLASH->ECCR & FLASH_FLAG_ECCC);
-
-  /* clear error flags */
-  __HAL_FLASH_CLEAR_FLAG(error);
-
-	exit_time = millis() + timeout;
+	return flash_erasePage(VEEPROM_FIRST_PAGE + n) == FLASH_ERR_NONE;
+}
 
-  while (__HAL_FLASH_GET_FLAG(FLASH_FLAG_CFGBSY) != 0x00U)
-  {
-    if (millis() >= exit_time)
-    {
-      return 0;
-    }
-  }
+static uint8_t _eeprom_writeSlot(uint8_t n, uint16_t slot, uint64_t data)
+{
+	return flash_programDoubleWord(VEEPROM_PAGE_ADDR(n) + (slot * 8), data) == FLASH_ERR_NONE;
+}
 
-	return 1;
+// CRC unit with its reset configuration (CRC-32, 0x04C11DB7)
+static void _eeprom_crcStart(void)
+{
+	LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CRC);
+	LL_CRC_SetPolynomialSize(CRC, LL_CRC_POLYLENGTH_32B);
+	LL_CRC_SetPolynomialCoef(CRC, LL_CRC_DEFAULT_CRC32_POLY);
+	LL_CRC_SetInputDataReverseMode(CRC, LL_CRC_INDATA_REVERSE_NONE);
+	LL_CRC_SetOutputDataReverseMode(CRC, LL_CRC_OUTDATA_REVERSE_NONE);
+	LL_CRC_SetInitialData(CRC, LL_CRC_DEFAULT_CRC_INITVALUE);
+	LL_CRC_ResetCRCCalculationUnit(CRC);
 }
 
-static void _program_doubleWord(uint32_t Address, uint64_t Data)
+static uint16_t _eeprom_check(uint16_t index, uint32_t value)
 {
-  /* Set PG bit */
-  SET_BIT(FLASH->CR, FLASH_CR_PG);
+	_eeprom_crcStart();
+	LL_CRC_FeedData32(CRC, index);
+	LL_CRC_FeedData32(CRC, value);
+	return (uint16_t)LL_CRC_ReadData32(CRC);
+}
 
-  /* Program first word */
-  *(uint32_t *)Address = (uint32_t)Data;
+static uint64_t _eeprom_readSlot(uint8_t n, uint16_t slot)
+{
+	return *(__IO uint64_t *)(VEEPROM_PAGE_ADDR(n) + (slot * 8));
+}
 
-  /* Barrier to ensure programming is performed in 2 steps, in right order
-    (independently of compiler optimization behavior) */
-  __ISB();
+static uint32_t _eeprom_word(uint16_t index)
+{
+	uint16_t i = index * 4;
+	return _eedata[i] | ((uint32_t)_eedata[i + 1] << 8) | ((uint32_t)_eedata[i + 2] << 16) | ((uint32_t)_eedata[i + 3] << 24);
+}
 
-  /* Program second word */
-  *(uint32_t *)(Address + 4U) = (uint32_t)(Data >> 32U);
+static bool _eeprom_recordValid(uint64_t record)
+{
+	uint16_t index = (uint16_t)record;
+	return index < DATA_EEPROM_WORDS && (uint16_t)(record >> 16) == _eeprom_check(index, (uint32_t)(record >> 32));
 }
 
-static void _eeprom_unlock(void)
+// CRC of the page header and the compacted records after it
+static uint32_t _eeprom_pageCRC(uint8_t n, uint32_t header)
 {
-	if (READ_BIT(FLASH->CR, FLASH_CR_LOCK) != 0x00U)
+	uint16_t records = header >> 16;
+	uint16_t slot;
+	uint64_t record;
+
+	_eeprom_crcStart();
+	LL_CRC_FeedData32(CRC, header);
+	for (slot = VEEPROM_FIRST_RECORD; slot < VEEPROM_FIRST_RECORD + records && slot < VEEPROM_SLOTS; slot++)
 	{
-		/* Authorize the FLASH Registers access */
-		WRITE_REG(FLASH->KEYR, FLASH_KEY1);
-		WRITE_REG(FLASH->KEYR, FLASH_KEY2);
+		record = _eeprom_readSlot(n, slot);
+		LL_CRC_FeedData32(CRC, (uint32_t)record);
+		LL_CRC_FeedData32(CRC, (uint32_t)(record >> 32));
 	}
+	return LL_CRC_ReadData32(CRC);
 }
 
-static void _eeprom_lock(void)
+static bool _eeprom_pageValid(uint8_t n)
 {
-	SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+	uint64_t header = _eeprom_readSlot(n, VEEPROM_SLOT_HEADER);
+
+	if (header == VEEPROM_BLANK || _eeprom_readSlot(n, VEEPROM_SLOT_OBSOLETE) != VEEPROM_BLANK)
+		return false;
+	return (uint32_t)(header >> 32) == _eeprom_pageCRC(n, (uint32_t)header);
 }
 
-static uint8_t _eeprom_massErase(void){
-	uint8_t status = 0;
-	uint32_t tmp;
-	uint32_t ee_page = (uint32_t)(((LL_GetFlashSize() * 1024)/FLASH_PAGE_SIZE) - 1);
-	status = _waitForLastOperation(FLASH_TIMEOUT_VALUE);
-	if(status == 0) { return 0; }
-	tmp = (FLASH->CR & ~FLASH_CR_PNB);
-  FLASH->CR = (tmp | (FLASH_CR_STRT | (ee_page <<  FLASH_CR_PNB_Pos) | FLASH_CR_PER));
-	status = _waitForLastOperation(FLASH_TIMEOUT_VALUE);
-	CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
-	return status;
+static void _eeprom_set(uint16_t address, uint8_t data)
+{
+	uint16_t index = address >> 2;
+
+	if (_eedata[address] != data)
+	{
+		_eedata[address] = data;
+		_dirty[index >> 5] |= (1UL << (index & 31));
+	}
 }
 
-static uint8_t _eeprom_writeDWord(uint32_t address, uint64_t data){
-	uint8_t status = 0;
-	address = DATA_EEPROM_BASE + address;
-	if(address > DATA_EEPROM_END) { return 0; }
-	status = _waitForLastOperation(FLASH_TIMEOUT_VALUE);
-	if(status == 0) { return 0; }
-	_program_doubleWord(address, data);
-	status = _waitForLastOperation(FLASH_TIMEOUT_VALUE);
-	CLEAR_BIT(FLASH->CR, FLASH_TYPEPROGRAM_DOUBLEWORD);
-	return status;
+// Write the whole image to the next page. The old page stays valid until
+// the new one has its header, and it's marked obsolete after that, so a
+// reset at any point keeps one complete copy.
+static uint8_t _eeprom_compact(void)
+{
+	uint8_t old = _page;
+	uint8_t next = (_slot == 0) ? 0 : ((_page + 1) % VEEPROM_PAGES);
+	uint16_t slot = VEEPROM_FIRST_RECORD;
+	uint16_t seq = _seq + 1;
+	uint16_t i;
+	uint32_t value, header;
+
+	if (_eeprom_erasePage(next) == 0)
+		return 0;
+	for (i = 0; i < DATA_EEPROM_WORDS; i++)
+	{
+		value = _eeprom_word(i);
+		if (value != 0xFFFFFFFFU && _eeprom_writeSlot(next, slot++, VEEPROM_RECORD(i, value)) == 0)
+			return 0;
+	}
+	header = seq | ((uint32_t)(slot - VEEPROM_FIRST_RECORD) << 16);
+	if (_eeprom_writeSlot(next, VEEPROM_SLOT_HEADER, ((uint64_t)_eeprom_pageCRC(next, header) << 32) | header) == 0)
+		return 0;
+	if (_slot != 0 && old != next)
+		_eeprom_writeSlot(old, VEEPROM_SLOT_OBSOLETE, 0);
+
+	for (i = 0; i < sizeof(_dirty) / sizeof(_dirty[0]); i++)
+		_dirty[i] = 0;
+	_seq = seq;
+	_page = next;
+	_slot = slot;
+	return 1;
 }
 
 /** 
@@ -186,42 +187,78 @@ static uint8_t _eeprom_writeDWord(uint32_t address, uint64_t data){
  */
 
 void veeprom_init(void){
-	uint16_t index = 0;
-	__IO uint32_t data32;
-	uint32_t address = DATA_EEPROM_BASE;
-	uint32_t endaddr = DATA_EEPROM_LIMIT;
-
-	while (address < endaddr)
-  {
-		index = address - DATA_EEPROM_BASE;
-    data32 = *(__IO uint32_t *)address;
-		_eedata[index] = (uint8_t)data32;
-		_eedata[index+1] = (uint8_t)(data32 >> 8U);
-		_eedata[index+2] = (uint8_t)(data32 >> 16U);
-		_eedata[index+3] = (uint8_t)(data32 >> 24U);
-    address = address + 4;
-  }
+	uint64_t record;
+	uint16_t index, slot, seq;
+	uint8_t n;
+
+	// Newest valid page (a reset while compacting leaves 2 valid pages)
+	_slot = 0;
+	for (n = 0; n < VEEPROM_PAGES; n++)
+	{
+		if (!_eeprom_pageValid(n))
+			continue;
+		seq = (uint16_t)_eeprom_readSlot(n, VEEPROM_SLOT_HEADER);
+		if (_slot == 0 || (int16_t)(seq - _seq) > 0)
+		{
+			_page = n;
+			_seq = seq;
+			_slot = VEEPROM_FIRST_RECORD;
+		}
+	}
+
+	for (index = 0; index < DATA_EEPROM_SIZE; index++)
+		_eedata[index] = 0xFF;
+	for (index = 0; index < sizeof(_dirty) / sizeof(_dirty[0]); index++)
+		_dirty[index] = 0;
+
+	if (_slot != 0)
+	{
+		// Replay the log, the last record of a word is its value. A record
+		// interrupted by a reset fails its check and is skipped.
+		for (slot = VEEPROM_FIRST_RECORD; slot < VEEPROM_SLOTS; slot++)
+		{
+			record = _eeprom_readSlot(_page, slot);
+			if (record == VEEPROM_BLANK)
+				break;
+			if (!_eeprom_recordValid(record))
+				continue;
+			index = (uint16_t)record * 4;
+			_eedata[index] = (uint8_t)(record >> 32);
+			_eedata[index + 1] = (uint8_t)(record >> 40);
+			_eedata[index + 2] = (uint8_t)(record >> 48);
+			_eedata[index + 3] = (uint8_t)(record >> 56);
+		}
+		_slot = slot;
+	}
+	else
+	{
+		// No valid page: old format (a plain image at the start of the last
+		// page) or blank. The words read are dirty, so they're written to
+		// the log by the next commit.
+		for (index = 0; index < DATA_EEPROM_SIZE; index += 4)
+			veeprom_writeWord(index, *(__IO uint32_t *)(DATA_EEPROM_BASE + index));
+	}
 }
 
 uint8_t veeprom_writeByte(uint16_t address, uint8_t data)
 {
-	_eedata[address] = (uint8_t)data;
+	_eeprom_set(address, (uint8_t)data);
 	return 1;
 }
 
 uint8_t veeprom_writeHalfWord(uint16_t address, uint16_t data)
 {
-	_eedata[address] = (uint8_t)data;
-	_eedata[address+1] = (uint8_t)(data >> 8U) ;
+	_eeprom_set(address, (uint8_t)data);
+	_eeprom_set(address+1, (uint8_t)(data >> 8U));
 	return 1;
 }
 
 uint8_t veeprom_writeWord(uint16_t address, uint32_t data)
 {
-	_eedata[address] = (uint8_t)data;
-	_eedata[address+1] = (uint8_t)(data >> 8U) ;
-	_eedata[address+2] = (uint8_t)(data >> 16U) ;
-	_eedata[address+3] = (uint8_t)(data >> 24U) ;
+	_eeprom_set(address, (uint8_t)data);
+	_eeprom_set(address+1, (uint8_t)(data >> 8U));
+	_eeprom_set(address+2, (uint8_t)(data >> 16U));
+	_eeprom_set(address+3, (uint8_t)(data >> 24U));
 	return 1;
 }
 
@@ -229,7 +266,7 @@ uint8_t veeprom_writeFloat(uint16_t address, float *data)
 {
 	uint8_t *p = (uint8_t *)data;
 	for(uint8_t i = 0; i < 4; i++){
-		_eedata[address + i] = *p++;
+		_eeprom_set(address + i, *p++);
 	}
 	return 1;
 }
@@ -266,25 +303,63 @@ void veeprom_readFloat(uint16_t address, float *rdata)
 	*p++ = _eedata[address+3];
 }
 
+bool veeprom_isDirty(void)
+{
+	uint16_t i;
+
+	for (i = 0; i < sizeof(_dirty) / sizeof(_dirty[0]); i++)
+	{
+		if (_dirty[i] != 0)
+			return true;
+	}
+	return false;
+}
+
 void veeprom_commit(void){
-	eedata_t d;
-	_eeprom_unlock();
-	_eeprom_massErase();
-	for(uint16_t i = 0; i < DATA_EEPROM_SIZE; i+=8 ){
-		for(uint8_t j = 0; j < 8; j++){
-			d.u8[j] = _eedata[i+j];
+	uint16_t i, index;
+	uint32_t pending;
+
+	if (!veeprom_isDirty())
+		return;
+
+	flash_unlock();
+	for (i = 0; i < sizeof(_dirty) / sizeof(_dirty[0]); i++)
+	{
+		pending = _dirty[i];
+		while (pending != 0)
+		{
+			if (_slot == 0 || _slot >= VEEPROM_SLOTS)
+			{
+				// The compacted page has all the dirty words too
+				_eeprom_compact();
+				flash_lock();
+				return;
+			}
+			index = (i * 32) + lowestBitSet(pending);
+			if (_eeprom_writeSlot(_page, _slot, VEEPROM_RECORD(index, _eeprom_word(index))) == 0)
+			{
+				flash_lock();
+				return;
+			}
+			_slot++;
+			pending &= pending - 1;
+			_dirty[i] = pending;
 		}
-		_eeprom_writeDWord(i, d.u64);
 	}
-	_eeprom_lock();
+	flash_lock();
 }
 
 void veeprom_clear(void){
 	uint16_t i = 0;
-	_eeprom_unlock();
-	_eeprom_massErase();
-	_eeprom_lock();
+	uint8_t n;
+	flash_unlock();
+	for (n = 0; n < VEEPROM_PAGES; n++)
+		_eeprom_erasePage(n);
+	flash_lock();
+	_slot = 0;
 	for(i = 0; i < DATA_EEPROM_SIZE; i++){
 		_eedata[i] = 255;
 	}
-}
\ No newline at end of file
+	for (i = 0; i < sizeof(_dirty) / sizeof(_dirty[0]); i++)
+		_dirty[i] = 0;
+}
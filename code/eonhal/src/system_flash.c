@@ -0,0 +1,357 @@
+/**
+  ******************************************************************************
+  * @file    system_flash.c
+  * @authors Pablo Fuentes, Joseph Peñafiel
+	* @version V1.0.1
+  * @date    2019
+  * @brief   System Internal Flash Functions
+  ******************************************************************************
+*/
+
+#include <stddef.h>
+#include "System.h"
+
+/**
+ ===============================================================================
+              ##### Definitions #####
+ ===============================================================================
+ */
+
+#define FLASH_KEY1 0x45670123U /*!< Flash key1 */
+#define FLASH_KEY2 0xCDEF89ABU /*!< Flash key2: used with FLASH_KEY1 \ \
+																		to unlock the FLASH registers access */
+
+#if defined(FLASH_PCROP_SUPPORT)
+#define FLASH_SR_ERRORS (FLASH_SR_OPERR | FLASH_SR_PROGERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | \
+												 FLASH_SR_SIZERR | FLASH_SR_PGSERR | FLASH_SR_MISERR | FLASH_SR_FASTERR | \
+												 FLASH_SR_RDERR | FLASH_SR_OPTVERR)
+#else
+#define FLASH_SR_ERRORS (FLASH_SR_OPERR | FLASH_SR_PROGERR | FLASH_SR_WRPERR | FLASH_SR_PGAERR | \
+												 FLASH_SR_SIZERR | FLASH_SR_PGSERR | FLASH_SR_MISERR | FLASH_SR_FASTERR | \
+												 FLASH_SR_OPTVERR)
+#endif
+
+// Timeouts in SysTick periods (ms). Page erase is 22 ms typ. and 40 ms max.
+#ifndef FLASH_TIMEOUT_MS
+#define FLASH_TIMEOUT_MS 100
+#endif
+
+// The fast programming sequence can't read the flash while it runs, so it's
+// executed from RAM (.data is copied to RAM by the startup code)
+#if defined(__GNUC__) && defined(__arm__)
+#define FLASH_RAMFUNC __attribute__((section(".data.flash_ramfunc"), noinline, long_call))
+#else
+#define FLASH_RAMFUNC
+#endif
+
+#define FLASH_END (FLASH_BASE + (LL_GetFlashSize() * 1024))
+
+/*------ NVIC Priority ------*/
+#ifndef FLASH_PRIORITY
+#define FLASH_PRIORITY 0x03
+#endif
+
+// Asynchronous operations
+#define FLASH_ASYNC_IDLE 0
+#define FLASH_ASYNC_ERASE 1
+#define FLASH_ASYNC_PROGRAM 2
+
+/**
+ ===============================================================================
+              ##### Linker symbols #####
+ ===============================================================================
+ */
+
+extern uint32_t _sidata; // flash image of .data, the last section of the program
+extern uint32_t _sdata;
+extern uint32_t _edata;
+
+/**
+ ===============================================================================
+              ##### Variables #####
+ ===============================================================================
+ */
+
+static volatile uint8_t _state = FLASH_ASYNC_IDLE;
+static volatile uint32_t _error = FLASH_ERR_NONE;
+static uint32_t _address;			// next page or double-word address
+static const uint64_t *_data; // next double-word
+static uint16_t _count;				// pages or double-words left
+static bool _relock;					// the flash was locked before the operation
+static flashCallback_t _callback;
+static void *_ctx;
+
+/**
+ ===============================================================================
+              ##### Private functions #####
+ ===============================================================================
+ */
+
+// Wait for BSY1 counting SysTick wraps (COUNTFLAG), so it doesn't depend on
+// the millis() interrupt and works with interrupts disabled or in tickless mode
+static uint32_t _waitForLastOperation(uint32_t timeout)
+{
+	uint32_t error;
+	uint32_t ms = 0;
+
+	(void)SysTick->CTRL; // clears COUNTFLAG
+	while ((FLASH->SR & FLASH_SR_BSY1) != 0)
+	{
+		if ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) != 0 && ++ms > timeout)
+			return FLASH_ERR_TIMEOUT;
+	}
+
+	// Only ECC correction can be checked here, ECC detection generates a NMI
+	error = FLASH->SR & FLASH_SR_ERRORS;
+	FLASH->SR = error | FLASH_SR_EOP;
+	if ((FLASH->ECCR & FLASH_ECCR_ECCC) != 0)
+		SET_BIT(FLASH->ECCR, FLASH_ECCR_ECCC);
+
+	while ((FLASH->SR & FLASH_SR_CFGBSY) != 0)
+	{
+		if ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) != 0 && ++ms > timeout)
+			return error | FLASH_ERR_TIMEOUT;
+	}
+	return error;
+}
+
+static bool _isWritable(uint32_t address, uint32_t size)
+{
+	return address >= flash_getPageAddress(flash_getFirstFreePage()) && address + size <= FLASH_END;
+}
+
+// 32 double-words in a row, the flash can't be read until BSY1 is cleared
+FLASH_RAMFUNC static void _programRow(uint32_t address, const uint32_t *row)
+{
+	volatile uint32_t *dst = (volatile uint32_t *)address;
+	uint8_t i;
+
+	SET_BIT(FLASH->CR, FLASH_CR_FSTPG);
+	for (i = 0; i < FLASH_ROW_SIZE / 4; i++)
+		dst[i] = row[i];
+	while ((FLASH->SR & FLASH_SR_BSY1) != 0)
+		;
+	CLEAR_BIT(FLASH->CR, FLASH_CR_FSTPG);
+}
+
+static void _asyncFinish(uint32_t error)
+{
+	CLEAR_BIT(FLASH->CR, FLASH_CR_PER | FLASH_CR_PG | FLASH_CR_EOPIE | FLASH_CR_ERRIE);
+	if (_relock)
+		SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+	_error = error;
+	_state = FLASH_ASYNC_IDLE;
+	if (_callback != NULL)
+		_callback(error, _ctx);
+}
+
+// Start the next step, its end is signaled by the EOP interrupt
+static void _asyncNext(void)
+{
+	if (_count == 0)
+	{
+		_asyncFinish(FLASH_ERR_NONE);
+		return;
+	}
+	_count--;
+	if (_state == FLASH_ASYNC_ERASE)
+	{
+		MODIFY_REG(FLASH->CR, FLASH_CR_PNB, FLASH_CR_STRT | (flash_getPage(_address) << FLASH_CR_PNB_Pos) | FLASH_CR_PER);
+		_address += FLASH_PAGE_SIZE;
+	}
+	else
+	{
+		SET_BIT(FLASH->CR, FLASH_CR_PG);
+		*(__IO uint32_t *)_address = (uint32_t)*_data;
+		__ISB();
+		*(__IO uint32_t *)(_address + 4U) = (uint32_t)(*_data >> 32U);
+		_address += 8;
+		_data++;
+	}
+}
+
+static uint32_t _asyncStart(uint8_t state, uint32_t address, const uint64_t *data, uint16_t count,
+														flashCallback_t callback, void *ctx)
+{
+	uint32_t error = _waitForLastOperation(FLASH_TIMEOUT_MS);
+
+	if (error != FLASH_ERR_NONE)
+		return error;
+	_address = address;
+	_data = data;
+	_count = count;
+	_callback = callback;
+	_ctx = ctx;
+	_error = FLASH_ERR_NONE;
+	_relock = READ_BIT(FLASH->CR, FLASH_CR_LOCK) != 0;
+	flash_unlock();
+	_state = state;
+
+	NVIC_SetPriority(FLASH_IRQn, FLASH_PRIORITY);
+	NVIC_EnableIRQ(FLASH_IRQn);
+	SET_BIT(FLASH->CR, FLASH_CR_EOPIE | FLASH_CR_ERRIE);
+	_asyncNext();
+	return FLASH_ERR_NONE;
+}
+
+/**
+ ===============================================================================
+              ##### Interrupt #####
+ ===============================================================================
+ */
+
+void FLASH_IRQHandler(void)
+{
+	uint32_t error = FLASH->SR & FLASH_SR_ERRORS;
+
+	FLASH->SR = error | FLASH_SR_EOP;
+	if (_state == FLASH_ASYNC_IDLE)
+		return;
+	CLEAR_BIT(FLASH->CR, FLASH_CR_PER | FLASH_CR_PG);
+	if (error != 0)
+		_asyncFinish(error);
+	else
+		_asyncNext();
+}
+
+/**
+ ===============================================================================
+              ##### Public functions #####
+ ===============================================================================
+ */
+
+void flash_unlock(void)
+{
+	if (READ_BIT(FLASH->CR, FLASH_CR_LOCK) != 0x00U)
+	{
+		/* Authorize the FLASH Registers access */
+		WRITE_REG(FLASH->KEYR, FLASH_KEY1);
+		WRITE_REG(FLASH->KEYR, FLASH_KEY2);
+	}
+}
+
+void flash_lock(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	// The asynchronous operation still needs FLASH->CR, it locks at the end
+	__disable_irq();
+	if (_state != FLASH_ASYNC_IDLE)
+		_relock = true;
+	else
+		SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+	__set_PRIMASK(primask);
+}
+
+uint16_t flash_getPages(void)
+{
+	return (LL_GetFlashSize() * 1024) / FLASH_PAGE_SIZE;
+}
+
+uint16_t flash_getFirstFreePage(void)
+{
+	uint32_t end = (uint32_t)&_sidata + ((uint32_t)&_edata - (uint32_t)&_sdata);
+	return (end - FLASH_BASE + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+}
+
+uint32_t flash_getPageAddress(uint16_t page)
+{
+	return FLASH_BASE + ((uint32_t)page * FLASH_PAGE_SIZE);
+}
+
+uint16_t flash_getPage(uint32_t address)
+{
+	return (address - FLASH_BASE) / FLASH_PAGE_SIZE;
+}
+
+uint32_t flash_erasePage(uint16_t page)
+{
+	uint32_t error;
+
+	if (_state != FLASH_ASYNC_IDLE)
+		return FLASH_ERR_BUSY;
+	if (page < flash_getFirstFreePage() || page >= flash_getPages())
+		return FLASH_ERR_ADDRESS;
+	error = _waitForLastOperation(FLASH_TIMEOUT_MS);
+	if (error != FLASH_ERR_NONE)
+		return error;
+	MODIFY_REG(FLASH->CR, FLASH_CR_PNB, FLASH_CR_STRT | ((uint32_t)page << FLASH_CR_PNB_Pos) | FLASH_CR_PER);
+	error = _waitForLastOperation(FLASH_TIMEOUT_MS);
+	CLEAR_BIT(FLASH->CR, FLASH_CR_PER);
+	return error;
+}
+
+uint32_t flash_programDoubleWord(uint32_t address, uint64_t data)
+{
+	uint32_t error;
+
+	if (_state != FLASH_ASYNC_IDLE)
+		return FLASH_ERR_BUSY;
+	if ((address & 7) != 0 || !_isWritable(address, 8))
+		return FLASH_ERR_ADDRESS;
+	error = _waitForLastOperation(FLASH_TIMEOUT_MS);
+	if (error != FLASH_ERR_NONE)
+		return error;
+
+	SET_BIT(FLASH->CR, FLASH_CR_PG);
+	*(__IO uint32_t *)address = (uint32_t)data;
+	/* Barrier to ensure programming is performed in 2 steps, in right order
+    (independently of compiler optimization behavior) */
+	__ISB();
+	*(__IO uint32_t *)(address + 4U) = (uint32_t)(data >> 32U);
+
+	error = _waitForLastOperation(FLASH_TIMEOUT_MS);
+	CLEAR_BIT(FLASH->CR, FLASH_CR_PG);
+	return error;
+}
+
+uint32_t flash_programRow(uint32_t address, const uint64_t *row)
+{
+	uint32_t error, primask;
+
+	if (_state != FLASH_ASYNC_IDLE)
+		return FLASH_ERR_BUSY;
+	// The row is read while the flash is busy, so it must be in RAM
+	if ((address & (FLASH_ROW_SIZE - 1)) != 0 || !_isWritable(address, FLASH_ROW_SIZE) ||
+			(uint32_t)row < SRAM_BASE)
+		return FLASH_ERR_ADDRESS;
+	error = _waitForLastOperation(FLASH_TIMEOUT_MS);
+	if (error != FLASH_ERR_NONE)
+		return error;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	_programRow(address, (const uint32_t *)row);
+	__set_PRIMASK(primask);
+
+	return _waitForLastOperation(FLASH_TIMEOUT_MS);
+}
+
+uint32_t flash_eraseAsync(uint16_t page, uint16_t count, flashCallback_t callback, void *ctx)
+{
+	if (_state != FLASH_ASYNC_IDLE)
+		return FLASH_ERR_BUSY;
+	if (count == 0 || page < flash_getFirstFreePage() || page + count > flash_getPages())
+		return FLASH_ERR_ADDRESS;
+	return _asyncStart(FLASH_ASYNC_ERASE, flash_getPageAddress(page), NULL, count, callback, ctx);
+}
+
+uint32_t flash_programAsync(uint32_t address, const uint64_t *data, uint16_t count,
+														flashCallback_t callback, void *ctx)
+{
+	if (_state != FLASH_ASYNC_IDLE)
+		return FLASH_ERR_BUSY;
+	if ((address & 7) != 0 || count == 0 || !_isWritable(address, (uint32_t)count * 8))
+		return FLASH_ERR_ADDRESS;
+	return _asyncStart(FLASH_ASYNC_PROGRAM, address, data, count, callback, ctx);
+}
+
+bool flash_isBusy(void)
+{
+	return _state != FLASH_ASYNC_IDLE;
+}
+
+uint32_t flash_getError(void)
+{
+	return _error;
+}
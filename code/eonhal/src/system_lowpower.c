@@ -9,6 +9,9 @@
 */
 
 #include "System.h"
+#if defined(CLOCK_WAKEUP_PIN)
+#include "gpio.h"
+#endif
 
 // Fix MACRO definition
 #undef LL_PWR_MODE_STOP0
@@ -16,19 +19,215 @@
 #define LL_PWR_MODE_STOP0 (0U)
 #define LL_PWR_MODE_STOP1 (PWR_CR1_LPMS_0)
 
+// With USE_TICKLESS the LPTIM wakes up the core to keep the timebase, the
+// core goes back to sleep until another interrupt is pending
+#if defined(USE_TICKLESS)
+#define LOWPOWER_WFI() \
+	do                 \
+	{                  \
+		__WFI();         \
+	} while (tickless_serviceWakeup())
+#else
+#define LOWPOWER_WFI() __WFI()
+#endif
+
+// Idle times shorter than this use Sleep mode, waking up from Stop takes longer
+#ifndef POWER_STOP_MIN_MS
+#define POWER_STOP_MIN_MS 3
+#endif
+
+#if !defined(USE_TICKLESS)
+extern volatile uint32_t __ticks_millis; // System.c
+#endif
+
+static volatile uint32_t _pm_sleep; // users that require Sleep mode
+static volatile uint32_t _pm_stop0; // users that require Stop 0 mode
+
+// System clock running before Stop mode, restored at the wakeup
+static struct
+{
+	uint32_t cfgr; // SW, HPRE and PPRE
+	uint32_t pllcfgr;
+	uint32_t latency;
+	uint32_t hsidiv;
+	uint32_t hse; // HSEON and HSEBYP
+	uint32_t load; // SysTick reload
+	uint32_t core; // SystemCoreClock
+} _clk;
+static volatile bool _clk_restored = true;
+static uint8_t _clk_wakeup = CLOCK_WAKEUP_WAIT;
+static volatile uint16_t _clk_micros; // first instruction to restored clock
+
+#if defined(CLOCK_WAKEUP_PIN)
+static GPIO_TypeDef *_clk_port;
+static uint16_t _clk_mask;
+#endif
+
 /** 
  ===============================================================================
-              ##### Public Function System Clock #####
+              ##### Private Functions System Clock #####
  ===============================================================================
  */
-static void nothing(void) {}
 
-static voidFuncPtr cur_clock = nothing;
+static void _clockSwitch(void)
+{
+	// HSI16 cycles counted from 0xFFFFFF since the wakeup
+	uint32_t cycles = 0xFFFFFF - SysTick->VAL;
+
+	// The flash latency is raised before the clock
+	MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, _clk.latency);
+	while ((FLASH->ACR & FLASH_ACR_LATENCY) != _clk.latency)
+		;
+	LL_RCC_SetHSIDiv(_clk.hsidiv);
+	MODIFY_REG(RCC->CFGR, RCC_CFGR_SW | RCC_CFGR_HPRE | RCC_CFGR_PPRE, _clk.cfgr);
+	while (LL_RCC_GetSysClkSource() != ((_clk.cfgr & RCC_CFGR_SW) << RCC_CFGR_SWS_Pos))
+		;
+	SysTick->LOAD = _clk.load;
+	SysTick->VAL = 0;
+	SystemCoreClock = _clk.core;
+	_clk_micros = (uint16_t)min(cycles / (HSI_VALUE / 1000000), 0xFFFF);
+	_clk_restored = true;
+#if defined(CLOCK_WAKEUP_PIN)
+	_clk_port->BRR = _clk_mask;
+#endif
+}
+
+// Save the clock and run from HSI16, the wakeup clock of Stop mode, so the
+// code runs at full speed before the PLL is locked
+static void _clockStop(void)
+{
+	if (_clk_restored)
+	{
+		_clk.cfgr = RCC->CFGR & (RCC_CFGR_SW | RCC_CFGR_HPRE | RCC_CFGR_PPRE);
+		_clk.pllcfgr = RCC->PLLCFGR;
+		_clk.latency = FLASH->ACR & FLASH_ACR_LATENCY;
+		_clk.hsidiv = LL_RCC_GetHSIDiv();
+		_clk.hse = RCC->CR & (RCC_CR_HSEON | RCC_CR_HSEBYP);
+		_clk.load = SysTick->LOAD;
+		_clk.core = SystemCoreClock;
+	}
+	else
+	{
+		// Asynchronous wakeup not finished, the PLL is stopped again
+		LL_RCC_DisableIT_PLLRDY();
+	}
+	LL_RCC_HSI_Enable();
+	while (LL_RCC_HSI_IsReady() != 1)
+		;
+	LL_RCC_SetHSIDiv(LL_RCC_HSI_DIV_1);
+	LL_RCC_SetSysClkSource(LL_RCC_SYS_CLKSOURCE_HSI);
+	while (LL_RCC_GetSysClkSource() != LL_RCC_SYS_CLKSOURCE_STATUS_HSI)
+		;
+	LL_RCC_SetAHBPrescaler(LL_RCC_SYSCLK_DIV_1);
+	LL_RCC_PLL_Disable();
+}
+
+// Restore the saved clock, the PLL is off after Stop mode
+static void _clockWakeup(void)
+{
+#if defined(CLOCK_WAKEUP_PIN)
+	_clk_port->BSRR = _clk_mask;
+#endif
+	// SysTick doesn't count in Stop mode, it counts the HSI16 cycles until the
+	// saved clock runs (millis() doesn't advance in between)
+	SysTick->LOAD = 0xFFFFFF;
+	SysTick->VAL = 0;
+	SystemCoreClock = HSI_VALUE;
+	_clk_restored = false;
+
+	// HSE is stopped in Stop mode, the system clock or the PLL can use it
+	if ((_clk.hse & RCC_CR_HSEON) && LL_RCC_HSE_IsReady() == 0)
+	{
+		if (_clk.hse & RCC_CR_HSEBYP)
+			LL_RCC_HSE_EnableBypass();
+		LL_RCC_HSE_Enable();
+		while (LL_RCC_HSE_IsReady() != 1)
+			;
+	}
+
+	if ((_clk.cfgr & RCC_CFGR_SW) == LL_RCC_SYS_CLKSOURCE_PLL)
+	{
+		RCC->PLLCFGR = _clk.pllcfgr;
+		LL_RCC_PLL_Enable();
+		if (_clk_wakeup == CLOCK_WAKEUP_ASYNC)
+		{
+			// Switched in the RCC interrupt
+			LL_RCC_ClearFlag_PLLRDY();
+			LL_RCC_EnableIT_PLLRDY();
+			NVIC_SetPriority(RCC_IRQn, 0);
+			NVIC_EnableIRQ(RCC_IRQn);
+			system_tickResume();
+			return;
+		}
+		while (LL_RCC_PLL_IsReady() != 1)
+			;
+	}
+	_clockSwitch();
+	system_tickResume();
+}
+
+/** 
+ ===============================================================================
+              ##### Interrupt #####
+ ===============================================================================
+ */
+
+void RCC_IRQHandler(void)
+{
+	if (LL_RCC_IsActiveFlag_PLLRDY())
+	{
+		LL_RCC_ClearFlag_PLLRDY();
+		LL_RCC_DisableIT_PLLRDY();
+		if (!_clk_restored)
+			_clockSwitch();
+	}
+}
+
+/** 
+ ===============================================================================
+              ##### Public Function System Clock #####
+ ===============================================================================
+ */
 
 void clock_init(void (*clockFunc)(void))
 {
 	clockFunc();
-	cur_clock = clockFunc;
+#if defined(CLOCK_WAKEUP_PIN)
+	gpio_mode(CLOCK_WAKEUP_PIN, OUTPUT_PP, NOPULL, SPEED_HIGH);
+	gpio_write(CLOCK_WAKEUP_PIN, LOW);
+	_clk_port = gpio_port(CLOCK_WAKEUP_PIN);
+	_clk_mask = gpio_pinMask(CLOCK_WAKEUP_PIN);
+#endif
+}
+
+void clock_setWakeup(uint8_t CLOCK_WAKEUP_x)
+{
+	_clk_wakeup = CLOCK_WAKEUP_x;
+}
+
+void clock_restore(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (!_clk_restored)
+	{
+		while (LL_RCC_PLL_IsReady() != 1)
+			;
+		LL_RCC_DisableIT_PLLRDY();
+		_clockSwitch();
+	}
+	__set_PRIMASK(primask);
+}
+
+bool clock_isRestored(void)
+{
+	return _clk_restored;
+}
+
+uint16_t clock_getWakeupMicros(void)
+{
+	return _clk_micros;
 }
 
 /** 
@@ -44,25 +243,25 @@ void clock_init(void (*clockFunc)(void))
 void system_sleepSeconds(uint32_t seconds)
 {
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
 	LL_LPM_EnableSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	__enable_irq();
-	LL_SYSTICK_EnableIT();
+	system_tickResume();
 }
 
 void system_sleepMillis(uint32_t milliseconds)
 {
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setWKUPMillis(milliseconds);
 	LL_LPM_EnableSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	__enable_irq();
-	LL_SYSTICK_EnableIT();
+	system_tickResume();
 	rtc_setWKUPMillis(0); //disable rtc interrupt
 }
 
@@ -75,24 +274,23 @@ void system_sleepLPSeconds(uint32_t seconds)
 	LL_FLASH_DisablePrefetch();
 	LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
 	LL_PWR_EnableFlashPowerDownInLPSleep();
-	LL_RCC_DeInit();
-	CLOCK_HSI_2MHZ();
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	_clockStop();
+	LL_RCC_SetHSIDiv(LL_RCC_HSI_DIV_8); // 2 MHz, the limit of Low power run mode
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
 	LL_PWR_EnableLowPowerRunMode();
 	LL_LPM_EnableSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	// Exitting low power modes
 	LL_PWR_DisableLowPowerRunMode();
 	LL_PWR_DisableFlashPowerDownInLPSleep();
-	while (LL_PWR_IsEnabledLowPowerRunMode() == 1)
+	while (LL_PWR_IsActiveFlag_REGLPF() == 1)
 		;
-	LL_RCC_DeInit();
-	cur_clock();
+	LL_RCC_SetHSIDiv(LL_RCC_HSI_DIV_1);
+	_clockWakeup();
 	__enable_irq();
-	LL_SYSTICK_EnableIT();
 }
 
 void system_sleepLPMillis(uint32_t milliseconds)
@@ -100,24 +298,23 @@ void system_sleepLPMillis(uint32_t milliseconds)
 	LL_FLASH_DisablePrefetch();
 	LL_APB1_GRP1_EnableClock(LL_APB1_GRP1_PERIPH_PWR);
 	LL_PWR_EnableFlashPowerDownInLPSleep();
-	LL_RCC_DeInit();
-	CLOCK_HSI_2MHZ();
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	_clockStop();
+	LL_RCC_SetHSIDiv(LL_RCC_HSI_DIV_8); // 2 MHz, the limit of Low power run mode
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setWKUPMillis(milliseconds);
 	LL_PWR_EnableLowPowerRunMode();
 	LL_LPM_EnableSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	// Exitting low power modes
 	LL_PWR_DisableLowPowerRunMode();
 	LL_PWR_DisableFlashPowerDownInLPSleep();
-	while (LL_PWR_IsEnabledLowPowerRunMode() == 1)
+	while (LL_PWR_IsActiveFlag_REGLPF() == 1)
 		;
-	LL_RCC_DeInit();
-	cur_clock();
+	LL_RCC_SetHSIDiv(LL_RCC_HSI_DIV_1);
+	_clockWakeup();
 	__enable_irq();
-	LL_SYSTICK_EnableIT();
 	rtc_setWKUPMillis(0);
 }
 
@@ -127,44 +324,49 @@ void system_sleepLPMillis(uint32_t milliseconds)
 
 void system_stop0Seconds(uint32_t seconds)
 {
-	CLOCK_HSI_2MHZ();
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	_clockStop();
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STOP0);
 	LL_LPM_EnableDeepSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	LL_LPM_EnableSleep();
-	cur_clock();
+	_clockWakeup();
 	__enable_irq();
 }
 
 void system_stop0Millis(uint32_t milliseconds)
 {
-	CLOCK_HSI_2MHZ();
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	_clockStop();
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setWKUPMillis(milliseconds);
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STOP0);
 	LL_LPM_EnableDeepSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	LL_LPM_EnableSleep();
-	cur_clock();
+	_clockWakeup();
 	__enable_irq();
 	rtc_setWKUPMillis(0);
 }
 
 void system_stop0UntilInterrupt(void)
 {
-	CLOCK_HSI_2MHZ();
-	LL_SYSTICK_DisableIT();
+	uint32_t primask = __get_PRIMASK();
+
+	// The interrupt runs once the clock is restored
+	__disable_irq();
+	_clockStop();
+	system_tickSuspend();
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STOP0);
 	LL_LPM_EnableDeepSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	LL_LPM_EnableSleep();
-	cur_clock();
+	_clockWakeup();
+	__set_PRIMASK(primask);
 }
 
 // ==========================================
@@ -173,44 +375,49 @@ void system_stop0UntilInterrupt(void)
 
 void system_stop1Seconds(uint32_t seconds)
 {
-	CLOCK_HSI_2MHZ();
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	_clockStop();
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STOP1);
 	LL_LPM_EnableDeepSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	LL_LPM_EnableSleep();
-	cur_clock();
+	_clockWakeup();
 	__enable_irq();
 }
 
 void system_stop1Millis(uint32_t milliseconds)
 {
-	CLOCK_HSI_2MHZ();
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	_clockStop();
+	system_tickSuspend();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setWKUPMillis(milliseconds);
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STOP1);
 	LL_LPM_EnableDeepSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	LL_LPM_EnableSleep();
-	cur_clock();
+	_clockWakeup();
 	__enable_irq();
 	rtc_setWKUPMillis(0);
 }
 
 void system_stop1UntilInterrupt(void)
 {
-	CLOCK_HSI_2MHZ();
-	LL_SYSTICK_DisableIT();
+	uint32_t primask = __get_PRIMASK();
+
+	// The interrupt runs once the clock is restored
+	__disable_irq();
+	_clockStop();
+	system_tickSuspend();
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STOP1);
 	LL_LPM_EnableDeepSleep();
-	__WFI();
+	LOWPOWER_WFI();
 	LL_LPM_EnableSleep();
-	cur_clock();
+	_clockWakeup();
+	__set_PRIMASK(primask);
 }
 
 // ==========================================
@@ -223,7 +430,7 @@ void system_standby(void)
 	{
 		LL_PWR_ClearFlag_SB();
 	}
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_ClearFlag_WU();
 #if defined(PWR_CR3_RRS)
 	LL_PWR_DisableSRAMRetention();
@@ -243,7 +450,7 @@ void system_standbySeconds(uint32_t seconds)
 		LL_PWR_ClearFlag_SB();
 	}
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_ClearFlag_WU();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
@@ -265,7 +472,7 @@ void system_standbyUntilWakeUpPin(uint32_t WAKEUP_PIN_x, uint8_t polarity)
 		LL_PWR_ClearFlag_SB();
 	}
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_DisableWakeUpPin(WAKEUP_PIN_x);
 	LL_PWR_ClearFlag_WU();
 	if (polarity)
@@ -303,7 +510,7 @@ void system_standbySRAM(void)
 	{
 		LL_PWR_ClearFlag_SB();
 	}
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_ClearFlag_WU();
 	LL_PWR_EnableSRAMRetention();
 	LL_PWR_SetPowerMode(LL_PWR_MODE_STANDBY);
@@ -321,7 +528,7 @@ void system_standbySRAMSeconds(uint32_t seconds)
 		LL_PWR_ClearFlag_SB();
 	}
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_ClearFlag_WU();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
@@ -341,7 +548,7 @@ void system_standbySRAMUntilWakeUpPin(uint32_t WAKEUP_PIN_x, uint8_t polarity)
 		LL_PWR_ClearFlag_SB();
 	}
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_DisableWakeUpPin(WAKEUP_PIN_x);
 	LL_PWR_ClearFlag_WU();
 	if (polarity)
@@ -379,7 +586,7 @@ void system_shutdown(void)
 	{
 		LL_PWR_ClearFlag_SB();
 	}
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_ClearFlag_WU();
 	LL_PWR_SetPowerMode(LL_PWR_MODE_SHUTDOWN);
 	LL_LPM_EnableDeepSleep();
@@ -396,7 +603,7 @@ void system_shutdownSeconds(uint32_t seconds)
 		LL_PWR_ClearFlag_SB();
 	}
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_ClearFlag_WU();
 	NVIC_EnableIRQ(RTC_TAMP_IRQn);
 	rtc_setAlarmBAfter(seconds);
@@ -415,7 +622,7 @@ void system_shutdownUntilWakeUpPin(uint32_t WAKEUP_PIN_x, uint8_t polarity)
 		LL_PWR_ClearFlag_SB();
 	}
 	__disable_irq();
-	LL_SYSTICK_DisableIT();
+	system_tickSuspend();
 	LL_PWR_DisableWakeUpPin(WAKEUP_PIN_x);
 	LL_PWR_ClearFlag_WU();
 	if (polarity)
@@ -441,6 +648,106 @@ void system_shutdownUntilWakeUpPin(uint32_t WAKEUP_PIN_x, uint8_t polarity)
 
 #endif
 
+// ==========================================
+// ==== Power Manager Functions
+// ==========================================
+
+void power_require(uint32_t POWER_USER_x, uint8_t POWER_MODE_x)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	_pm_sleep &= ~POWER_USER_x;
+	_pm_stop0 &= ~POWER_USER_x;
+	if (POWER_MODE_x <= POWER_MODE_SLEEP)
+		_pm_sleep |= POWER_USER_x;
+	else if (POWER_MODE_x == POWER_MODE_STOP0)
+		_pm_stop0 |= POWER_USER_x;
+	__set_PRIMASK(primask);
+}
+
+void power_release(uint32_t POWER_USER_x)
+{
+	power_require(POWER_USER_x, POWER_MODE_STOP1);
+}
+
+uint8_t power_getMode(void)
+{
+	if (_pm_sleep != 0)
+		return POWER_MODE_SLEEP;
+	if (_pm_stop0 != 0)
+		return POWER_MODE_STOP0;
+	return POWER_MODE_STOP1;
+}
+
+uint8_t system_idle(uint32_t deadline)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t ms;
+	uint8_t mode;
+#if !defined(USE_TICKLESS)
+	uint32_t start = 0, rtc_irq = 0;
+#endif
+
+	__disable_irq();
+	ms = deadline - millis();
+	if ((int32_t)ms <= 0)
+	{
+		__set_PRIMASK(primask);
+		return POWER_MODE_RUN;
+	}
+	mode = power_getMode();
+	if (ms < POWER_STOP_MIN_MS)
+		mode = POWER_MODE_SLEEP;
+
+#if defined(USE_TICKLESS)
+	tickless_setDeadline(TICKLESS_DEADLINE_IDLE, deadline);
+#else
+	// The SysTick stops in Stop mode, the RTC wakes up the core and measures
+	// the time to keep millis()
+	if (LL_RCC_IsEnabledRTC() == 0)
+		mode = POWER_MODE_SLEEP;
+	if (mode != POWER_MODE_SLEEP)
+	{
+		rtc_irq = NVIC->ISER[0] & (1UL << RTC_TAMP_IRQn); // enabled for the alarms
+		system_tickSuspend();
+		rtc_setWKUPMillis((uint16_t)min(ms, 0xFFFF));
+		start = (uint32_t)rtc_getUnixMs();
+	}
+#endif
+
+	if (mode == POWER_MODE_SLEEP)
+	{
+		LL_LPM_EnableSleep();
+		__WFI();
+	}
+	else
+	{
+		_clockStop();
+		LL_PWR_SetPowerMode((mode == POWER_MODE_STOP0) ? LL_PWR_MODE_STOP0 : LL_PWR_MODE_STOP1);
+		LL_LPM_EnableDeepSleep();
+		__WFI();
+		LL_LPM_EnableSleep();
+		_clockWakeup();
+#if !defined(USE_TICKLESS)
+		rtc_setWKUPMillis(0);
+		if (rtc_irq)
+			NVIC_EnableIRQ(RTC_TAMP_IRQn);
+		// The calendar shadow registers aren't updated in Stop mode
+		LL_RTC_DisableWriteProtection(RTC);
+		LL_RTC_WaitForSynchro(RTC);
+		LL_RTC_EnableWriteProtection(RTC);
+		__ticks_millis += (uint32_t)rtc_getUnixMs() - start;
+#endif
+	}
+
+#if defined(USE_TICKLESS)
+	tickless_clearDeadline(TICKLESS_DEADLINE_IDLE);
+#endif
+	__set_PRIMASK(primask);
+	return mode;
+}
+
 // ==========================================
 // ==== Other Functions
 // ==========================================
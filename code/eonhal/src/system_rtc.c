@@ -9,6 +9,7 @@
 */
 
 #include "System.h"
+#include "stm32g0xx_ll_tim.h"
 
 /** 
  ===============================================================================
@@ -39,6 +40,11 @@
 #define RTC_EXTI_LINE LL_EXTI_LINE_19
 #define RTC_EXTI_LINE_TAMPER LL_EXTI_LINE_21
 
+// Calibration: RTC clock periods per capture of TIM16 and limits
+#define RTC_CAL_CAPTURE_PSC 8
+#define RTC_CAL_MAX_PPM 480		 // smooth calibration range is -487 to +488 ppm
+#define RTC_CAL_CYCLE (1UL << 20) // RTCCLK pulses of the 32 s calibration cycle (32768 Hz)
+
 // Definiciones CHAR2NUM y CHARISNUM
 #define RTC_CHAR2NUM(x) ((x) - '0')
 #define RTC_CHARISNUM(x) ((x) >= '0' && (x) <= '9')
@@ -49,6 +55,8 @@
  ===============================================================================
  */
 
+static uint32_t _rtcClock = LSE_VALUE; // RTCCLK in Hz, for the wakeup timer
+
 __STATIC_INLINE void LSI_init(void)
 {
 	LL_RCC_LSI_Enable();
@@ -106,6 +114,33 @@ __STATIC_INLINE void RTC_setWAKEUPTIMER(uint32_t wakeupCounter, uint32_t wakeupC
 	LL_RTC_EnableWriteProtection(RTC); //ok
 }
 
+// Wait for a TIM16 capture counting SysTick wraps, so it ends if the clock is off
+static bool _rtc_waitCapture(void)
+{
+	uint8_t ms = 0;
+
+	(void)SysTick->CTRL; // clears COUNTFLAG
+	while ((TIM16->SR & TIM_SR_CC1IF) == 0)
+	{
+		if ((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) != 0 && ++ms > 2)
+			return false;
+	}
+	return true;
+}
+
+// Time and date registers (BCD, 24 hour format) to unix time
+static uint32_t _rtc_toUnix(uint32_t tr, uint32_t dr)
+{
+	uint32_t days = date2days(2000 + __LL_RTC_CONVERT_BCD2BIN((dr >> RTC_DR_YU_Pos) & 0xFF),
+														__LL_RTC_CONVERT_BCD2BIN((dr >> RTC_DR_MU_Pos) & 0x1F),
+														__LL_RTC_CONVERT_BCD2BIN(dr & (RTC_DR_DT | RTC_DR_DU)));
+
+	return (days * 86400) +
+				 (__LL_RTC_CONVERT_BCD2BIN((tr >> RTC_TR_HU_Pos) & 0x3F) * 3600) +
+				 (__LL_RTC_CONVERT_BCD2BIN((tr >> RTC_TR_MNU_Pos) & 0x7F) * 60) +
+				 __LL_RTC_CONVERT_BCD2BIN(tr & (RTC_TR_ST | RTC_TR_SU));
+}
+
 /** 
  ===============================================================================
 							##### Public Functions #####
@@ -134,8 +169,9 @@ void rtc_initLsi(bool resetBKP)
 	/*Initialize RTC and set the Time and Date */
 	RTC_InitStruct.HourFormat = LL_RTC_HOURFORMAT_24HOUR;
 	RTC_InitStruct.AsynchPrescaler = 127;
-	RTC_InitStruct.SynchPrescaler = 255;
+	RTC_InitStruct.SynchPrescaler = (LSI_VALUE / 128) - 1;
 	LL_RTC_Init(RTC, &RTC_InitStruct);
+	_rtcClock = LSI_VALUE;
 }
 
 void rtc_initLse(bool resetBKP)
@@ -162,6 +198,7 @@ void rtc_initLse(bool resetBKP)
 	RTC_InitStruct.AsynchPrescaler = 127;
 	RTC_InitStruct.SynchPrescaler = 255;
 	LL_RTC_Init(RTC, &RTC_InitStruct);
+	_rtcClock = LSE_VALUE;
 }
 
 void rtc_setTime(uint8_t hours, uint8_t minutes, uint8_t seconds)
@@ -221,16 +258,31 @@ void rtc_getDate(RTCDate_t *rtc_date)
 
 uint32_t rtc_getUnix(void)
 {
-	RTCTime_t rtc_time;
-	RTCDate_t rtc_date;
-	rtc_getTime(&rtc_time);
-	rtc_getDate(&rtc_date);
-	return time2unix(rtc_date.day, rtc_date.month, rtc_date.year, rtc_time.hours, rtc_time.minutes, rtc_time.seconds);
+	// Reading TR locks the DR shadow register until DR is read
+	uint32_t tr = RTC->TR;
+	return _rtc_toUnix(tr, RTC->DR);
+}
+
+uint64_t rtc_getUnixMs(void)
+{
+	uint32_t ssr, tr, dr, prediv_s;
+	int32_t ms;
+
+	// Reading SSR locks the TR and DR shadow registers until DR is read
+	ssr = RTC->SSR;
+	tr = RTC->TR;
+	dr = RTC->DR;
+
+	// SSR counts down from PREDIV_S, it's greater than PREDIV_S (negative
+	// fraction) after a shift operation until the next second
+	prediv_s = LL_RTC_GetSynchPrescaler(RTC);
+	ms = ((int32_t)(prediv_s - ssr) * 1000) / (int32_t)(prediv_s + 1);
+	return ((uint64_t)_rtc_toUnix(tr, dr) * 1000) + ms;
 }
 
 void rtc_setWKUPMillis(uint16_t milliseconds)
 {
-	uint16_t ms_fix = 0;
+	uint32_t ms_fix = 0;
 
 	LL_RTC_ClearFlag_WUT(RTC);	//added ok
 	LL_RTC_WAKEUP_Disable(RTC); //ok
@@ -244,11 +296,163 @@ void rtc_setWKUPMillis(uint16_t milliseconds)
 	if (milliseconds != 0)
 	{
 		NVIC_EnableIRQ(RTC_TAMP_IRQn);
-		ms_fix = (uint16_t)(((float)2.048 * milliseconds) - 1); // 2048 = 32768 / 16
+		// RTCCLK / 16 counts, 2.048 per ms with LSE
+		ms_fix = (((uint32_t)milliseconds * (_rtcClock / 16)) + 500) / 1000;
+		ms_fix = (ms_fix > 0x10000) ? 0xFFFF : (ms_fix != 0) ? ms_fix - 1 : 0;
 		RTC_setWAKEUPTIMER(ms_fix, LL_RTC_WAKEUPCLOCK_DIV_16);
 	}
 }
 
+uint32_t rtc_measureClock(uint16_t periods)
+{
+	uint32_t last, capture, ticks = 0;
+	uint64_t clock;
+	uint32_t saved[9];
+	uint16_t i;
+	LL_RCC_ClocksTypeDef clocks;
+	bool enabled = LL_APB2_GRP1_IsEnabledClock(LL_APB2_GRP1_PERIPH_TIM16);
+
+	// A running TIM16 (PWM, stimer, tim_interrupt) can't be borrowed, a stopped
+	// one gets its registers back at the end
+	if (enabled && LL_TIM_IsEnabledCounter(TIM16))
+		return 0;
+	if (enabled)
+	{
+		saved[0] = TIM16->CR1;
+		saved[1] = TIM16->DIER;
+		saved[2] = TIM16->CCMR1;
+		saved[3] = TIM16->CCER;
+		saved[4] = TIM16->TISEL;
+		saved[5] = TIM16->PSC;
+		saved[6] = TIM16->ARR;
+		saved[7] = TIM16->CCR1; // overwritten by the captures
+		saved[8] = TIM16->CNT;
+	}
+
+	// TIM16 input 1 is connected to the RTC clock, each capture is
+	// RTC_CAL_CAPTURE_PSC periods of it counted with the timer clock
+	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_TIM16);
+	LL_TIM_DisableCounter(TIM16);
+	LL_TIM_CC_DisableChannel(TIM16, LL_TIM_CHANNEL_CH1);
+	TIM16->DIER = 0;
+	LL_TIM_SetUpdateSource(TIM16, LL_TIM_UPDATESOURCE_COUNTER); // no UIF on UG
+	LL_TIM_SetRemap(TIM16, (LL_RCC_GetRTCClockSource() == LL_RCC_RTC_CLKSOURCE_LSE) ? LL_TIM_TIM16_TI1_RMP_LSE : LL_TIM_TIM16_TI1_RMP_LSI);
+	LL_TIM_SetPrescaler(TIM16, 0);
+	LL_TIM_SetAutoReload(TIM16, 0xFFFF);
+	LL_TIM_IC_SetActiveInput(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_ACTIVEINPUT_DIRECTTI);
+	LL_TIM_IC_SetPrescaler(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_ICPSC_DIV8);
+	LL_TIM_IC_SetFilter(TIM16, LL_TIM_CHANNEL_CH1, LL_TIM_IC_FILTER_FDIV1);
+	LL_TIM_CC_EnableChannel(TIM16, LL_TIM_CHANNEL_CH1);
+	LL_TIM_GenerateEvent_UPDATE(TIM16);
+	LL_TIM_ClearFlag_CC1(TIM16);
+	LL_TIM_EnableCounter(TIM16);
+
+	// The first capture is the start of the measurement
+	if (_rtc_waitCapture())
+	{
+		last = LL_TIM_IC_GetCaptureCH1(TIM16); // clears CC1IF
+		for (i = 0; i < periods; i++)
+		{
+			if (!_rtc_waitCapture())
+			{
+				ticks = 0;
+				break;
+			}
+			capture = LL_TIM_IC_GetCaptureCH1(TIM16);
+			ticks += (uint16_t)(capture - last);
+			last = capture;
+		}
+	}
+
+	LL_TIM_DisableCounter(TIM16);
+	LL_TIM_CC_DisableChannel(TIM16, LL_TIM_CHANNEL_CH1);
+	if (enabled)
+	{
+		// CH1 back in output mode before CCR1 is written, UG loads the
+		// preloaded PSC, ARR and CCR1 (BDTR and RCR aren't touched)
+		TIM16->CCMR1 = saved[2];
+		TIM16->CCR1 = saved[7];
+		TIM16->CCER = saved[3];
+		TIM16->TISEL = saved[4];
+		TIM16->PSC = saved[5];
+		TIM16->ARR = saved[6];
+		LL_TIM_GenerateEvent_UPDATE(TIM16);
+		TIM16->CNT = saved[8];
+		LL_TIM_ClearFlag_CC1(TIM16);
+		TIM16->CR1 = saved[0];
+		TIM16->DIER = saved[1];
+	}
+	else
+	{
+		LL_TIM_SetRemap(TIM16, LL_TIM_TIM16_TI1_RMP_GPIO);
+		LL_APB2_GRP1_DisableClock(LL_APB2_GRP1_PERIPH_TIM16);
+	}
+
+	if (ticks == 0)
+		return 0;
+	// Timer clock is 2 x PCLK if the APB is divided
+	LL_RCC_GetSystemClocksFreq(&clocks);
+	clock = (uint64_t)clocks.PCLK1_Frequency * RTC_CAL_CAPTURE_PSC * periods * 1000;
+	if (LL_RCC_GetAPB1Prescaler() != LL_RCC_APB1_DIV_1)
+		clock *= 2;
+	return (uint32_t)((clock + (ticks / 2)) / ticks);
+}
+
+bool rtc_calibrate(uint32_t clock_mhz)
+{
+	uint32_t prediv_a, prediv_s = 0, target = 0;
+	int64_t diff;
+	int32_t minus;
+	uint32_t plus;
+
+	// Prescalers closest to the clock (PREDIV_A as high as possible, it uses
+	// less power), the rest is corrected with the smooth calibration
+	for (prediv_a = 128; prediv_a >= 16; prediv_a /= 2)
+	{
+		prediv_s = ((clock_mhz / 1000) + (prediv_a / 2)) / prediv_a;
+		if (prediv_s == 0 || prediv_s > 0x8000)
+			continue;
+		target = prediv_a * prediv_s * 1000; // mHz
+		diff = (int64_t)target - clock_mhz;
+		if (((diff < 0 ? -diff : diff) * 1000000) <= ((int64_t)clock_mhz * RTC_CAL_MAX_PPM))
+			break;
+	}
+	if (prediv_a < 16)
+		return false;
+
+	// Calibrated clock: f * (1 + (512 * CALP - CALM) / (2^20 + CALM - 512 * CALP))
+	if (diff <= 0)
+	{
+		plus = 0;
+		minus = (int32_t)((((-diff) * RTC_CAL_CYCLE) + (target / 2)) / target);
+	}
+	else
+	{
+		plus = LL_RTC_CALIB_INSERTPULSE_SET;
+		minus = 512 - (int32_t)(((diff * (RTC_CAL_CYCLE - 512)) + (target / 2)) / target);
+	}
+	minus = constrain(minus, 0, 511);
+
+	LL_RTC_DisableWriteProtection(RTC);
+	if (LL_RTC_EnterInitMode(RTC) != SUCCESS)
+	{
+		LL_RTC_EnableWriteProtection(RTC);
+		return false;
+	}
+	LL_RTC_SetAsynchPrescaler(RTC, prediv_a - 1);
+	LL_RTC_SetSynchPrescaler(RTC, prediv_s - 1);
+	LL_RTC_ExitInitMode(RTC);
+
+	while (LL_RTC_IsActiveFlag_RECALP(RTC) != 0)
+	{
+	}
+	WRITE_REG(RTC->CALR, plus | LL_RTC_CALIB_PERIOD_32SEC | (uint32_t)minus);
+	LL_RTC_EnableWriteProtection(RTC);
+
+	_rtcClock = clock_mhz / 1000;
+	return true;
+}
+
 void rtc_setWKUPSeconds(uint16_t seconds)
 {
 	LL_RTC_ClearFlag_WUT(RTC);	//added ok
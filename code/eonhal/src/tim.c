@@ -9,6 +9,7 @@
 */
 
 #include "tim.h"
+#include "System.h"
 #include "stm32g0xx_ll_bus.h"
 #include "stm32g0xx_ll_rcc.h"
 
@@ -104,6 +105,47 @@ uint8_t tim_clkEnableAndGetIRQn(TIM_TypeDef *TIMx)
 	return 0;
 }
 
+uint32_t tim_powerUser(TIM_TypeDef *TIMx)
+{
+#if defined(TIM1)
+	if (TIMx == TIM1)
+		return POWER_USER_TIM1;
+#endif
+#if defined(TIM2)
+	if (TIMx == TIM2)
+		return POWER_USER_TIM2;
+#endif
+#if defined(TIM3)
+	if (TIMx == TIM3)
+		return POWER_USER_TIM3;
+#endif
+#if defined(TIM6)
+	if (TIMx == TIM6)
+		return POWER_USER_TIM6;
+#endif
+#if defined(TIM7)
+	if (TIMx == TIM7)
+		return POWER_USER_TIM7;
+#endif
+#if defined(TIM14)
+	if (TIMx == TIM14)
+		return POWER_USER_TIM14;
+#endif
+#if defined(TIM15)
+	if (TIMx == TIM15)
+		return POWER_USER_TIM15;
+#endif
+#if defined(TIM16)
+	if (TIMx == TIM16)
+		return POWER_USER_TIM16;
+#endif
+#if defined(TIM17)
+	if (TIMx == TIM17)
+		return POWER_USER_TIM17;
+#endif
+	return 0;
+}
+
 uint32_t tim_getSrcClk(TIM_TypeDef *TIMx)
 {
 	uint8_t tim_clock_factor = 1;
@@ -118,25 +160,21 @@ uint32_t tim_getSrcClk(TIM_TypeDef *TIMx)
 
 uint32_t tim_getMinPrescalerAndMaxPeriod(timebase_t *parameter, TIM_TypeDef *TIMx, uint32_t desired_frecuency)
 {
-
 	uint32_t timer_source_freq;
-	uint32_t tick_frecuency = 0;
-	uint32_t max_period = 0x0000FFFF;
-	uint32_t max_prescaler = 0x0000FFFF;
+	uint32_t cycles;
 
 	timer_source_freq = tim_getSrcClk(TIMx);
-
-	max_period = max_period + 1;
-
-	parameter->prescaler = 0;
-	do
-	{
-
-		parameter->prescaler++;
-		tick_frecuency = (timer_source_freq) / (parameter->prescaler);
-		parameter->period = ((tick_frecuency) / (desired_frecuency));
-
-	} while ((parameter->period > (max_period)) && (parameter->prescaler <= (max_prescaler + 1)));
+	cycles = timer_source_freq / desired_frecuency;
+
+	// Smallest prescaler where the period fits in 16 bits
+	parameter->prescaler = (cycles + 0xFFFF) >> 16;
+	if (parameter->prescaler == 0)
+		parameter->prescaler = 1;
+	if (parameter->prescaler > 0x10000)
+		parameter->prescaler = 0x10000;
+	parameter->period = (timer_source_freq / parameter->prescaler) / desired_frecuency;
+	if (parameter->period > 0x10000)
+		parameter->period = 0x10000;
 	if (parameter->period == 0)
 		parameter->period = 1;
 	return timer_source_freq;
@@ -169,6 +207,9 @@ void tim_interrupt(TIM_TypeDef *TIMx, uint32_t prescaler, uint32_t period)
 
 	NVIC_SetPriority((IRQn_Type)tim_irqn, 0);
 	NVIC_EnableIRQ((IRQn_Type)tim_irqn);
+
+	// The timers stop with PCLK in Stop mode
+	power_require(tim_powerUser(TIMx), POWER_MODE_SLEEP);
 }
 
 void tim_interruptMs(TIM_TypeDef *TIMx, uint32_t ms)
@@ -194,4 +235,19 @@ void tim_interruptMs(TIM_TypeDef *TIMx, uint32_t ms)
 
 	NVIC_SetPriority((IRQn_Type)tim_irqn, 0);
 	NVIC_EnableIRQ((IRQn_Type)tim_irqn);
+
+	// The timers stop with PCLK in Stop mode
+	power_require(tim_powerUser(TIMx), POWER_MODE_SLEEP);
+}
+
+void tim_off(TIM_TypeDef *TIMx)
+{
+	LL_TIM_DisableIT_UPDATE(TIMx);
+	LL_TIM_DisableCounter(TIMx);
+	power_release(tim_powerUser(TIMx));
+}
+
+void tim_triggerOutput(TIM_TypeDef *TIMx, uint32_t TIM_TRGO_x)
+{
+	LL_TIM_SetTriggerOutput(TIMx, TIM_TRGO_x);
 }
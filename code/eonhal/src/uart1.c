@@ -10,6 +10,7 @@
 
 #include "uart1.h"
 #include "uart_helper.h"
+#include "System.h"
 
 #if (defined(USART1) || defined(UART1))
 /** 
@@ -73,6 +74,9 @@ void uart1_init(uint32_t baudrate, pin_t tx, pin_t rx)
 	LL_USART_Enable(USART1);
 
 	LL_USART_EnableIT_RXNE(USART1);
+
+	// Clocked by PCLK, it can't receive in Stop mode
+	power_require(POWER_USER_UART1, POWER_MODE_SLEEP);
 }
 
 void uart1_rs485_init(uint32_t baudrate, pin_t tx, pin_t rx, pin_t de, uint8_t de_polarity)
@@ -116,6 +120,9 @@ void uart1_rs485_init(uint32_t baudrate, pin_t tx, pin_t rx, pin_t de, uint8_t d
 	LL_USART_Enable(USART1);
 
 	LL_USART_EnableIT_RXNE(USART1);
+
+	// Clocked by PCLK, it can't receive in Stop mode
+	power_require(POWER_USER_UART1, POWER_MODE_SLEEP);
 }
 
 void uart1_off(void)
@@ -124,6 +131,7 @@ void uart1_off(void)
 	NVIC_DisableIRQ(USART1_IRQn);
 	LL_USART_Disable(USART1);
 	LL_USART_DisableIT_RXNE(USART1);
+	power_release(POWER_USER_UART1);
 }
 
 /** 
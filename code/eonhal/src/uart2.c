@@ -10,6 +10,7 @@
 
 #include "uart2.h"
 #include "uart_helper.h"
+#include "System.h"
 
 #if (defined(USART2) || defined(UART2))
 /** 
@@ -73,6 +74,9 @@ void uart2_init(uint32_t baudrate, pin_t tx, pin_t rx)
 	LL_USART_Enable(USART2);
 
 	LL_USART_EnableIT_RXNE(USART2);
+
+	// Clocked by PCLK, it can't receive in Stop mode
+	power_require(POWER_USER_UART2, POWER_MODE_SLEEP);
 }
 
 void uart2_rs485_init(uint32_t baudrate, pin_t tx, pin_t rx, pin_t de, uint8_t de_polarity)
@@ -116,6 +120,9 @@ void uart2_rs485_init(uint32_t baudrate, pin_t tx, pin_t rx, pin_t de, uint8_t d
 	LL_USART_Enable(USART2);
 
 	LL_USART_EnableIT_RXNE(USART2);
+
+	// Clocked by PCLK, it can't receive in Stop mode
+	power_require(POWER_USER_UART2, POWER_MODE_SLEEP);
 }
 
 void uart2_off(void)
@@ -124,6 +131,7 @@ void uart2_off(void)
 	NVIC_DisableIRQ(USART2_IRQn);
 	LL_USART_Disable(USART2);
 	LL_USART_DisableIT_RXNE(USART2);
+	power_release(POWER_USER_UART2);
 }
 
 /** 
@@ -10,30 +10,16 @@
 
 #include "unix_time.h"
 
-/** 
- ===============================================================================
-              ##### Constants #####
- ===============================================================================
- */
-
-/* Days in a month */
-static uint8_t RTC_DaysInMonths[2][12] = {
-		{31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}, /* Not leap year */
-		{31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}	/* Leap year */
-};
-
 /** 
  ===============================================================================
               ##### Definitions #####
  ===============================================================================
  */
 
-#define RTC_LEAP_YEAR(year) ((((year) % 4 == 0) && ((year) % 100 != 0)) || ((year) % 400 == 0))
-#define RTC_DAYS_IN_YEAR(x) RTC_LEAP_YEAR(x) ? 366 : 365
-#define RTC_OFFSET_YEAR 1970 // Start Year for Unix
 #define RTC_SECONDS_PER_DAY 86400
 #define RTC_SECONDS_PER_HOUR 3600
 #define RTC_SECONDS_PER_MINUTE 60
+#define RTC_DAYS_TO_1970 719468 // days from 0000-03-01 to 1970-01-01
 
 /** 
  ===============================================================================
@@ -41,116 +27,50 @@ static uint8_t RTC_DaysInMonths[2][12] = {
  ===============================================================================
  */
 
+// Dates from 2000 to 2106-02-07 (the end of the 32-bit unix time)
 uint32_t time2unix(uint8_t day, uint8_t month, uint8_t year, uint8_t hours, uint8_t minutes, uint8_t seconds)
 {
-	uint32_t t_days = 0, unix_seconds = 0;
-	uint16_t i;
-	uint16_t t_year = (uint16_t)(year + 2000);
-
-	if (t_year < RTC_OFFSET_YEAR)
-		return 0;
-
-	// Days from 1970 until the specified year
-	for (i = RTC_OFFSET_YEAR; i < t_year; i++)
-	{
-		t_days += RTC_DAYS_IN_YEAR(i);
-	}
-
-	// Days that has been passed from the specified year, according to the input month
-	for (i = 1; i < month; i++)
-	{
-		t_days += RTC_DaysInMonths[RTC_LEAP_YEAR(t_year)][i - 1];
-	}
-
-	// Day starts with 1
-	t_days += day - 1;
-	unix_seconds = t_days * RTC_SECONDS_PER_DAY;
-	unix_seconds += hours * RTC_SECONDS_PER_HOUR;
-	unix_seconds += minutes * RTC_SECONDS_PER_MINUTE;
-	unix_seconds += seconds;
-
-	return (uint32_t)unix_seconds;
+	return (date2days(2000 + year, month, day) * RTC_SECONDS_PER_DAY) +
+				 ((uint32_t)hours * RTC_SECONDS_PER_HOUR) + ((uint32_t)minutes * RTC_SECONDS_PER_MINUTE) + seconds;
 }
 
+// Civil from days, the inverse of date2days(). The year is found from the
+// day of the 400-year era correcting the leap days of 4, 100 and 400 years.
 void unix2time(uint32_t unix, LocalTime_t *t)
 {
-	uint16_t year;
-
-	// Get seconds from unix
-	t->seconds = unix % 60;
-
-	// Go to minutes
-	unix /= 60;
-	// Get minutes
-	t->minutes = unix % 60;
-
-	// Go to hours
-	unix /= 60;
-	// Get hours
-	t->hours = unix % 24;
-
-	// Go to days
-	unix /= 24;
-	// Get week day
-	// Monday is day one
-	t->weekday = (unix + 3) % 7 + 1;
-
-	// Get year
-	year = 1970;
-	while (1)
-	{
-		if (RTC_LEAP_YEAR(year))
-		{
-			if (unix >= 366)
-			{
-				unix -= 366;
-			}
-			else
-			{
-				break;
-			}
-		}
-		else if (unix >= 365)
-		{
-			unix -= 365;
-		}
-		else
-		{
-			break;
-		}
-		year++;
-	}
-	// Get year in xx format
-	t->year = (uint8_t)(year - 2000);
+	uint32_t days = unix / RTC_SECONDS_PER_DAY;
+	uint32_t secs = unix - (days * RTC_SECONDS_PER_DAY);
+	uint32_t z = days + RTC_DAYS_TO_1970;
+	uint32_t era = z / 146097;
+	uint32_t doe = z - (era * 146097);																		 // [0, 146096]
+	uint32_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365; // [0, 399]
+	uint32_t doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));					 // [0, 365]
+	uint32_t mp = ((5 * doy) + 2) / 153;																	 // [0, 11], March is 0
+	uint32_t month = (mp < 10) ? mp + 3 : mp - 9;
+
+	t->hours = secs / RTC_SECONDS_PER_HOUR;
+	secs -= t->hours * RTC_SECONDS_PER_HOUR;
+	t->minutes = secs / RTC_SECONDS_PER_MINUTE;
+	t->seconds = secs - (t->minutes * RTC_SECONDS_PER_MINUTE);
+
+	// Monday is day one (1970-01-01 was Thursday)
+	t->weekday = ((days + 3) % 7) + 1;
+
+	t->day = doy - (((153 * mp) + 2) / 5) + 1;
+	t->month = month;
+	// Year in xx format
+	t->year = (uint8_t)(yoe + (era * 400) + (month <= 2) - 2000);
+}
 
-	// Get month
-	for (t->month = 0; t->month < 12; t->month++)
-	{
-		if (RTC_LEAP_YEAR(year))
-		{
-			if (unix >= (uint32_t)RTC_DaysInMonths[1][t->month])
-			{
-				unix -= RTC_DaysInMonths[1][t->month];
-			}
-			else
-			{
-				break;
-			}
-		}
-		else if (unix >= (uint32_t)RTC_DaysInMonths[0][t->month])
-		{
-			unix -= RTC_DaysInMonths[0][t->month];
-		}
-		else
-		{
-			break;
-		}
-	}
-	// Get month
-	// Month starts with 1
-	t->month++;
+// Days from civil (proleptic Gregorian), with the year starting in March so
+// the leap day is the last one. 400-year eras of 146097 days, no loops.
+uint32_t date2days(uint16_t year, uint8_t month, uint8_t day)
+{
+	uint32_t y = year - (month <= 2);
+	uint32_t era = y / 400;
+	uint32_t yoe = y - (era * 400);																			 // [0, 399]
+	uint32_t doy = ((153 * (month > 2 ? month - 3 : month + 9)) + 2) / 5 + day - 1; // [0, 365]
+	uint32_t doe = (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;						 // [0, 146096]
 
-	// Get date
-	// Day starts with 1
-	t->day = unix + 1;
+	return (era * 146097) + doe - RTC_DAYS_TO_1970;
 }